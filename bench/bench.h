@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Shared helpers of the benchmark programs, header only so every file in
+ * bench/ stays a standalone executable. */
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Pin the calling thread to a cpu, negative cpus leave it unpinned. */
+static inline int pin_thread(int cpu) {
+    if (cpu < 0) {
+        return 0;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+#endif  // BENCH_H
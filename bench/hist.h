@@ -0,0 +1,68 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Log bucketed latency histogram in the spirit of HdrHistogram: values are
+ * grouped by their highest set bit, and every power of two is split into
+ * 2^HIST_SUB_BITS linear sub buckets. Recording is a couple of shifts and the
+ * relative error of a reported value stays below 2^-HIST_SUB_BITS.
+ */
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} hist_t;
+
+static inline void hist_init(hist_t *hist) { memset(hist, 0, sizeof(*hist)); }
+
+static inline size_t hist_index(uint64_t value) {
+    if (value < 2 * HIST_SUB_BUCKETS) {
+        return value;
+    }
+    unsigned shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+    // value >> shift lies in [HIST_SUB_BUCKETS, 2 * HIST_SUB_BUCKETS)
+    return shift * HIST_SUB_BUCKETS + (value >> shift);
+}
+
+/* Lowest value that falls into the bucket at index. */
+static inline uint64_t hist_value(size_t index) {
+    if (index < 2 * HIST_SUB_BUCKETS) {
+        return index;
+    }
+    unsigned shift = index / HIST_SUB_BUCKETS - 1;
+    return (uint64_t)(index - shift * HIST_SUB_BUCKETS) << shift;
+}
+
+static inline void hist_record(hist_t *hist, uint64_t value) {
+    hist->counts[hist_index(value)]++;
+    hist->total++;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+/* Value at or below which the given fraction (0..1) of recordings lie. */
+static inline uint64_t hist_percentile(hist_t *hist, double fraction) {
+    uint64_t rank = (uint64_t)(fraction * hist->total);
+    if (rank >= hist->total) {
+        return hist->max;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen > rank) {
+            return hist_value(i);
+        }
+    }
+    return hist->max;
+}
+
+#endif  // HIST_H
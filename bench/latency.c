@@ -0,0 +1,194 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/ringbuf.h"
+#include "hist.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+/*
+ * One-way latency through a ringbuffer. The producer stamps every message
+ * right before ringbuffer_write, the consumer takes the difference right
+ * after ringbuffer_read returned it and records it in a log bucketed
+ * histogram. Prints one CSV line with the percentiles in nanoseconds.
+ *
+ * usage: latency [-n messages] [-s message_size] [-r ring_size]
+ *                [-i interval_ns] [-p producer_cpu,consumer_cpu] [-t] [-b]
+ *   -i  pace the producer, 0 sends back to back (latency includes queueing)
+ *   -p  pin producer and consumer threads
+ *   -t  stamp with rdtsc instead of CLOCK_MONOTONIC_RAW
+ *   -b  busy poll on an empty ring instead of yielding the cpu
+ */
+
+typedef struct {
+    rbctx_t *ctx;
+    size_t messages;
+    size_t message_size;
+    uint64_t interval_ns;
+    int cpu;
+} args_t;
+
+int use_tsc = 0;
+int busy_poll = 0;
+double ns_per_tick = 1.0;
+
+static inline uint64_t timestamp(void) {
+#if HAVE_TSC
+    if (use_tsc) {
+        return __rdtsc();
+    }
+#endif
+    return now_ns();
+}
+
+/* Measure the tsc frequency against the monotonic clock. */
+void calibrate_tsc(void) {
+#if HAVE_TSC
+    uint64_t ns_start = now_ns();
+    uint64_t tsc_start = __rdtsc();
+    while (now_ns() - ns_start < 100000000) {
+    }
+    ns_per_tick = (double)(now_ns() - ns_start) / (__rdtsc() - tsc_start);
+#endif
+}
+
+void *producer(void *arg) {
+    args_t *args = (args_t *)arg;
+    pin_thread(args->cpu);
+    uint8_t *message = calloc(1, args->message_size);
+
+    uint64_t next = now_ns();
+    for (size_t i = 0; i < args->messages; i++) {
+        if (args->interval_ns > 0) {
+            next += args->interval_ns;
+            while (now_ns() < next) {
+            }
+        }
+        uint64_t stamp = timestamp();
+        memcpy(message, &stamp, sizeof(stamp));
+        while (ringbuffer_write(args->ctx, message, args->message_size) !=
+               SUCCESS) {
+        }
+    }
+    free(message);
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    args_t *args = (args_t *)arg;
+    pin_thread(args->cpu);
+    uint8_t *buffer = malloc(args->message_size);
+    hist_t *hist = malloc(sizeof(hist_t));
+    hist_init(hist);
+
+    for (size_t i = 0; i < args->messages; i++) {
+        size_t buffer_len = args->message_size;
+        while (ringbuffer_read(args->ctx, buffer, &buffer_len) != SUCCESS) {
+            buffer_len = args->message_size;
+            if (!busy_poll) {
+                sched_yield();
+            }
+        }
+        uint64_t now = timestamp();
+        uint64_t stamp;
+        memcpy(&stamp, buffer, sizeof(stamp));
+        hist_record(hist, (uint64_t)((now - stamp) * ns_per_tick));
+    }
+    free(buffer);
+    return hist;
+}
+
+int main(int argc, char *argv[]) {
+    size_t ring_size = 64 * 1024;
+    args_t producer_args = {NULL, 1000000, 64, 0, -1};
+    args_t consumer_args;
+
+    int opt;
+    int producer_cpu = -1, consumer_cpu = -1;
+    while ((opt = getopt(argc, argv, "n:s:r:i:p:tb")) != -1) {
+        switch (opt) {
+            case 'n':
+                producer_args.messages = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                producer_args.message_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                ring_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                producer_args.interval_ns = strtoull(optarg, NULL, 10);
+                break;
+            case 'p':
+                if (sscanf(optarg, "%d,%d", &producer_cpu, &consumer_cpu) !=
+                    2) {
+                    fprintf(stderr, "-p expects producer_cpu,consumer_cpu\n");
+                    exit(1);
+                }
+                break;
+            case 't':
+                if (!HAVE_TSC) {
+                    fprintf(stderr, "rdtsc is not available, using clock\n");
+                }
+                use_tsc = HAVE_TSC;
+                break;
+            case 'b':
+                busy_poll = 1;
+                break;
+            default:
+                fprintf(stderr,
+                        "Usage: %s [-n messages] [-s message_size] "
+                        "[-r ring_size] [-i interval_ns] "
+                        "[-p producer_cpu,consumer_cpu] [-t] [-b]\n",
+                        argv[0]);
+                exit(1);
+        }
+    }
+    if (producer_args.message_size < sizeof(uint64_t) ||
+        producer_args.message_size + sizeof(size_t) >= ring_size) {
+        fprintf(stderr, "message size has to be between %zu and %zu\n",
+                sizeof(uint64_t), ring_size - sizeof(size_t) - 1);
+        exit(1);
+    }
+    if (use_tsc) {
+        calibrate_tsc();
+    }
+
+    rbctx_t ctx;
+    void *rbuf = malloc(ring_size);
+    ringbuffer_init(&ctx, rbuf, ring_size);
+    producer_args.ctx = &ctx;
+    producer_args.cpu = producer_cpu;
+    consumer_args = producer_args;
+    consumer_args.cpu = consumer_cpu;
+
+    pthread_t p_id, c_id;
+    pthread_create(&c_id, NULL, consumer, &consumer_args);
+    pthread_create(&p_id, NULL, producer, &producer_args);
+    pthread_join(p_id, NULL);
+    hist_t *hist;
+    pthread_join(c_id, (void **)&hist);
+
+    printf(
+        "clock,messages,message_size,ring_size,interval_ns,p50_ns,p99_ns,"
+        "p999_ns,max_ns\n");
+    printf("%s,%zu,%zu,%zu,%lu,%lu,%lu,%lu,%lu\n", use_tsc ? "tsc" : "monotonic_raw",
+           producer_args.messages, producer_args.message_size, ring_size,
+           producer_args.interval_ns, hist_percentile(hist, 0.5),
+           hist_percentile(hist, 0.99), hist_percentile(hist, 0.999),
+           hist->max);
+
+    free(hist);
+    ringbuffer_destroy(&ctx);
+    free(rbuf);
+    return 0;
+}
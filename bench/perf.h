@@ -0,0 +1,123 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * Hardware performance counters around a benchmark run, via perf_event_open.
+ * Counters are opened for the calling process with inherit set, so threads
+ * created after perf_start are counted once they have been joined.
+ *
+ * Cache-line transfers (loads that hit a modified line in another core,
+ * HITM) have no generic event. Set RB_PERF_HITM to the raw event of the cpu,
+ * e.g. RB_PERF_HITM=0x04d2 (MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM on Skylake).
+ * Counters the kernel refuses (see /proc/sys/kernel/perf_event_paranoid) are
+ * reported as empty fields.
+ */
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_HITM,
+    PERF_NR_OF_COUNTERS
+};
+
+#define PERF_CSV_HEADER \
+    "cycles_per_msg,instructions_per_msg,l1d_misses_per_msg," \
+    "llc_misses_per_msg,hitm_per_msg"
+
+typedef struct {
+    int fds[PERF_NR_OF_COUNTERS];
+    uint64_t values[PERF_NR_OF_COUNTERS];
+} perf_t;
+
+static inline int perf_open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static inline void perf_open(perf_t *perf) {
+    uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D |
+                             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    perf->fds[PERF_CYCLES] =
+        perf_open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    perf->fds[PERF_INSTRUCTIONS] =
+        perf_open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fds[PERF_L1D_MISSES] =
+        perf_open_counter(PERF_TYPE_HW_CACHE, l1d_read_miss);
+    perf->fds[PERF_LLC_MISSES] =
+        perf_open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+    perf->fds[PERF_HITM] = -1;
+    const char *hitm = getenv("RB_PERF_HITM");
+    if (hitm != NULL) {
+        perf->fds[PERF_HITM] =
+            perf_open_counter(PERF_TYPE_RAW, strtoull(hitm, NULL, 0));
+    }
+
+    if (perf->fds[PERF_CYCLES] < 0) {
+        perror("perf_event_open, hardware counters are left empty");
+    }
+}
+
+static inline void perf_start(perf_t *perf) {
+    for (int i = 0; i < PERF_NR_OF_COUNTERS; i++) {
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+static inline void perf_stop(perf_t *perf) {
+    for (int i = 0; i < PERF_NR_OF_COUNTERS; i++) {
+        perf->values[i] = 0;
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(perf->fds[i], &perf->values[i], sizeof(uint64_t)) !=
+                sizeof(uint64_t)) {
+                perf->values[i] = 0;
+            }
+        }
+    }
+}
+
+/* Print the counters divided by the number of messages as CSV fields. */
+static inline void perf_print(perf_t *perf, size_t messages) {
+    for (int i = 0; i < PERF_NR_OF_COUNTERS; i++) {
+        if (perf->fds[i] >= 0) {
+            printf(",%.2f", (double)perf->values[i] / messages);
+        } else {
+            printf(",");
+        }
+    }
+}
+
+static inline void perf_close(perf_t *perf) {
+    for (int i = 0; i < PERF_NR_OF_COUNTERS; i++) {
+        if (perf->fds[i] >= 0) {
+            close(perf->fds[i]);
+        }
+    }
+}
+
+#endif  // PERF_H
@@ -0,0 +1,568 @@
+#include "bench.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "../include/ringbuf.h"
+#include "../include/ringbuf_mpsc.h"
+#include "../include/ringbuf_pool.h"
+#include "perf.h"
+
+/*
+ * Throughput sweep over producer/consumer counts, message sizes and ring
+ * sizes. Every configuration moves the same number of bytes through the
+ * ringbuffer and through two baselines:
+ *   pipe     length-free fixed size messages over a pipe(2)
+ *   eventfd  a mutex protected queue of copied messages, bounded to the same
+ *            number of messages as the ring, with eventfd semaphores for
+ *            items and free space
+ * The ringbuffer runs with length prefixed messages, in slot mode, with
+ * producers that coalesce writes into batches of up to 4 KiB, and passing
+ * handles of pooled buffers that producers fill and consumers use in place,
+ * with the ring size as the pool size, and on the lock-free single consumer
+ * engine of ringbuf_mpsc.h (single consumer runs only). Results are printed
+ * as CSV, together with hardware counters per message where perf_event_open
+ * is permitted (see perf.h).
+ *
+ * usage: throughput [-P max_producers] [-C max_consumers] [-b bytes_per_run]
+ */
+
+#define MAX_THREADS 64
+#define COALESCE_STAGE_SIZE 4096
+
+size_t message_sizes[] = {8, 64, 512, 4096, 65536};
+size_t ring_sizes[] = {64 * 1024, 1024 * 1024};
+
+typedef struct {
+    size_t producers;
+    size_t consumers;
+    size_t message_size;
+    size_t ring_size;
+    size_t messages;  // in total, a multiple of producers * consumers
+} config_t;
+
+typedef struct {
+    config_t *config;
+    void *channel;
+} thread_args_t;
+
+/********************************************************************
+ * RINGBUFFER
+ *********************************************************************/
+
+void *ring_producer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    rbctx_t *ctx = ((thread_args_t *)arg)->channel;
+    uint8_t *message = calloc(1, config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->producers; i++) {
+        while (ringbuffer_write(ctx, message, config->message_size) !=
+               SUCCESS) {
+        }
+    }
+    free(message);
+    return NULL;
+}
+
+// Producer that publishes through a coalescing handle, see ringbuffer_flush
+void *coalesced_producer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    rbctx_t *ctx = ((thread_args_t *)arg)->channel;
+    uint8_t *message = calloc(1, config->message_size);
+    size_t stage_size = COALESCE_STAGE_SIZE;
+    uint8_t *stage = malloc(stage_size);
+    rbcoalesce_t coalescer;
+    ringbuffer_coalesce_init(&coalescer, ctx, stage, stage_size, 0, 0);
+
+    for (size_t i = 0; i < config->messages / config->producers; i++) {
+        while (ringbuffer_coalesce_write(&coalescer, message,
+                                         config->message_size) != SUCCESS) {
+        }
+    }
+    while (ringbuffer_flush(&coalescer) != SUCCESS) {
+    }
+    free(stage);
+    free(message);
+    return NULL;
+}
+
+void *ring_consumer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    rbctx_t *ctx = ((thread_args_t *)arg)->channel;
+    uint8_t *buffer = malloc(config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->consumers; i++) {
+        size_t buffer_len = config->message_size;
+        while (ringbuffer_read(ctx, buffer, &buffer_len) != SUCCESS) {
+            buffer_len = config->message_size;
+            sched_yield();
+        }
+        if (buffer_len != config->message_size) {
+            fprintf(stderr, "ring: got %zu bytes, expected %zu\n", buffer_len,
+                    config->message_size);
+            exit(1);
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+void *ring_setup(config_t *config) {
+    rbctx_t *ctx = malloc(sizeof(rbctx_t));
+    ringbuffer_init(ctx, malloc(config->ring_size), config->ring_size);
+    return ctx;
+}
+
+void *slots_setup(config_t *config) {
+    rbctx_t *ctx = malloc(sizeof(rbctx_t));
+    ringbuffer_init_slots(ctx, malloc(config->ring_size), config->ring_size,
+                          config->message_size);
+    return ctx;
+}
+
+void ring_teardown(void *channel) {
+    rbctx_t *ctx = channel;
+    free(ctx->begin);
+    ringbuffer_destroy(ctx);
+    free(ctx);
+}
+
+/********************************************************************
+ * BUFFER POOL
+ *********************************************************************/
+
+typedef struct {
+    rbctx_t ctx;
+    rbpool_t pool;
+} pooled_t;
+
+void *pooled_producer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    pooled_t *pooled = ((thread_args_t *)arg)->channel;
+    uint8_t *message = calloc(1, config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->producers; i++) {
+        rbhandle_t handle;
+        while (ringbuffer_pool_acquire(&pooled->pool, &handle) != SUCCESS) {
+            sched_yield();
+        }
+        memcpy(ringbuffer_pool_data(&pooled->pool, handle), message,
+               config->message_size);
+        handle.length = config->message_size;
+        while (ringbuffer_write_handle(&pooled->ctx, handle) != SUCCESS) {
+        }
+    }
+    free(message);
+    return NULL;
+}
+
+void *pooled_consumer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    pooled_t *pooled = ((thread_args_t *)arg)->channel;
+
+    for (size_t i = 0; i < config->messages / config->consumers; i++) {
+        rbhandle_t handle;
+        while (ringbuffer_read_handle(&pooled->ctx, &handle) != SUCCESS) {
+            sched_yield();
+        }
+        if (handle.length != config->message_size) {
+            fprintf(stderr, "pooled: got %u bytes, expected %zu\n",
+                    handle.length, config->message_size);
+            exit(1);
+        }
+        ringbuffer_pool_release(&pooled->pool, handle);
+    }
+    return NULL;
+}
+
+void *pooled_setup(config_t *config) {
+    pooled_t *pooled = malloc(sizeof(pooled_t));
+    ringbuffer_pool_init(&pooled->pool, malloc(config->ring_size),
+                         config->ring_size, config->message_size);
+    // One slot more than buffers, the ring never fills before the pool
+    size_t ring_size = (pooled->pool.nr_of_buffers + 1) * sizeof(rbhandle_t);
+    ringbuffer_init_slots(&pooled->ctx, malloc(ring_size), ring_size,
+                          sizeof(rbhandle_t));
+    return pooled;
+}
+
+void pooled_teardown(void *channel) {
+    pooled_t *pooled = channel;
+    free(pooled->ctx.begin);
+    free(pooled->pool.begin);
+    ringbuffer_destroy(&pooled->ctx);
+    free(pooled);
+}
+
+/********************************************************************
+ * LOCK-FREE MPSC
+ *********************************************************************/
+
+void *mpsc_producer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    rbmpsc_t *ring = ((thread_args_t *)arg)->channel;
+    uint8_t *message = calloc(1, config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->producers; i++) {
+        while (ringbuffer_mpsc_write(ring, message, config->message_size) !=
+               SUCCESS) {
+            sched_yield();
+        }
+    }
+    free(message);
+    return NULL;
+}
+
+void *mpsc_consumer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    rbmpsc_t *ring = ((thread_args_t *)arg)->channel;
+    uint8_t *buffer = malloc(config->message_size);
+
+    for (size_t i = 0; i < config->messages; i++) {
+        size_t buffer_len = config->message_size;
+        while (ringbuffer_mpsc_read(ring, buffer, &buffer_len) != SUCCESS) {
+            sched_yield();
+        }
+        if (buffer_len != config->message_size) {
+            fprintf(stderr, "mpsc: got %zu bytes, expected %zu\n", buffer_len,
+                    config->message_size);
+            exit(1);
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+void *mpsc_setup(config_t *config) {
+    rbmpsc_t *ring = aligned_alloc(64, sizeof(rbmpsc_t));
+    ringbuffer_mpsc_init(ring, malloc(config->ring_size), config->ring_size);
+    return ring;
+}
+
+void mpsc_teardown(void *channel) {
+    rbmpsc_t *ring = channel;
+    free(ring->begin);
+    free(ring);
+}
+
+/********************************************************************
+ * PIPE
+ *********************************************************************/
+
+int write_all(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (n > 0) {
+            data += n;
+            len -= n;
+        }
+    }
+    return 0;
+}
+
+int read_all(int fd, uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, data, len);
+        if (n <= 0 && errno != EINTR) {
+            return -1;
+        }
+        if (n > 0) {
+            data += n;
+            len -= n;
+        }
+    }
+    return 0;
+}
+
+void *pipe_producer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    int *fds = ((thread_args_t *)arg)->channel;
+    uint8_t *message = calloc(1, config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->producers; i++) {
+        if (write_all(fds[1], message, config->message_size) != 0) {
+            perror("pipe write");
+            exit(1);
+        }
+    }
+    free(message);
+    return NULL;
+}
+
+void *pipe_consumer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    int *fds = ((thread_args_t *)arg)->channel;
+    uint8_t *buffer = malloc(config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->consumers; i++) {
+        if (read_all(fds[0], buffer, config->message_size) != 0) {
+            perror("pipe read");
+            exit(1);
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+void *pipe_setup(config_t *config) {
+    (void)config;
+    int *fds = malloc(2 * sizeof(int));
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    return fds;
+}
+
+void pipe_teardown(void *channel) {
+    int *fds = channel;
+    close(fds[0]);
+    close(fds[1]);
+    free(fds);
+}
+
+/********************************************************************
+ * EVENTFD + QUEUE
+ *********************************************************************/
+
+typedef struct {
+    uint8_t **messages;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+    pthread_mutex_t mtx;
+    int items;  // eventfd semaphore counting queued messages
+    int space;  // eventfd semaphore counting free entries
+} queue_t;
+
+void eventfd_wait(int fd) {
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) != sizeof(value)) {
+    }
+}
+
+void eventfd_post(int fd) {
+    uint64_t value = 1;
+    while (write(fd, &value, sizeof(value)) != sizeof(value)) {
+    }
+}
+
+void *queue_producer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    queue_t *queue = ((thread_args_t *)arg)->channel;
+    uint8_t *message = calloc(1, config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->producers; i++) {
+        uint8_t *copy = malloc(config->message_size);
+        memcpy(copy, message, config->message_size);
+
+        eventfd_wait(queue->space);
+        pthread_mutex_lock(&queue->mtx);
+        queue->messages[queue->head++ % queue->capacity] = copy;
+        pthread_mutex_unlock(&queue->mtx);
+        eventfd_post(queue->items);
+    }
+    free(message);
+    return NULL;
+}
+
+void *queue_consumer(void *arg) {
+    config_t *config = ((thread_args_t *)arg)->config;
+    queue_t *queue = ((thread_args_t *)arg)->channel;
+    uint8_t *buffer = malloc(config->message_size);
+
+    for (size_t i = 0; i < config->messages / config->consumers; i++) {
+        eventfd_wait(queue->items);
+        pthread_mutex_lock(&queue->mtx);
+        uint8_t *message = queue->messages[queue->tail++ % queue->capacity];
+        pthread_mutex_unlock(&queue->mtx);
+        eventfd_post(queue->space);
+
+        memcpy(buffer, message, config->message_size);
+        free(message);
+    }
+    free(buffer);
+    return NULL;
+}
+
+void *queue_setup(config_t *config) {
+    queue_t *queue = malloc(sizeof(queue_t));
+    // As many messages as the ringbuffer could hold
+    queue->capacity =
+        config->ring_size / (config->message_size + sizeof(size_t));
+    queue->messages = malloc(queue->capacity * sizeof(uint8_t *));
+    queue->head = 0;
+    queue->tail = 0;
+    pthread_mutex_init(&queue->mtx, NULL);
+    queue->items = eventfd(0, EFD_SEMAPHORE);
+    queue->space = eventfd(queue->capacity, EFD_SEMAPHORE);
+    return queue;
+}
+
+void queue_teardown(void *channel) {
+    queue_t *queue = channel;
+    close(queue->items);
+    close(queue->space);
+    pthread_mutex_destroy(&queue->mtx);
+    free(queue->messages);
+    free(queue);
+}
+
+/********************************************************************
+ * HARNESS
+ *********************************************************************/
+
+typedef struct {
+    const char *name;
+    void *(*setup)(config_t *config);
+    void (*teardown)(void *channel);
+    void *(*producer)(void *arg);
+    void *(*consumer)(void *arg);
+} impl_t;
+
+impl_t impls[] = {
+    {"ringbuffer", ring_setup, ring_teardown, ring_producer, ring_consumer},
+    {"ringbuffer_slots", slots_setup, ring_teardown, ring_producer,
+     ring_consumer},
+    {"ringbuffer_coalesced", ring_setup, ring_teardown, coalesced_producer,
+     ring_consumer},
+    {"ringbuffer_pooled", pooled_setup, pooled_teardown, pooled_producer,
+     pooled_consumer},
+    {"ringbuffer_mpsc", mpsc_setup, mpsc_teardown, mpsc_producer,
+     mpsc_consumer},
+    {"pipe", pipe_setup, pipe_teardown, pipe_producer, pipe_consumer},
+    {"eventfd", queue_setup, queue_teardown, queue_producer, queue_consumer},
+};
+
+int supported(impl_t *impl, config_t *config) {
+    if (config->message_size + sizeof(size_t) >= config->ring_size / 2) {
+        return 0;
+    }
+    // Pipe writes and reads are only atomic up to PIPE_BUF, beyond that
+    // concurrent threads would tear messages apart
+    if (impl->producer == pipe_producer) {
+        if (config->consumers > 1) {
+            return 0;
+        }
+        if (config->producers > 1 && config->message_size > PIPE_BUF) {
+            return 0;
+        }
+    }
+    if (impl->consumer == mpsc_consumer && config->consumers > 1) {
+        return 0;
+    }
+    return 1;
+}
+
+void run(impl_t *impl, config_t *config, perf_t *perf) {
+    void *channel = impl->setup(config);
+    thread_args_t args = {config, channel};
+    pthread_t producers[MAX_THREADS], consumers[MAX_THREADS];
+
+    perf_start(perf);
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < config->consumers; i++) {
+        pthread_create(&consumers[i], NULL, impl->consumer, &args);
+    }
+    for (size_t i = 0; i < config->producers; i++) {
+        pthread_create(&producers[i], NULL, impl->producer, &args);
+    }
+    for (size_t i = 0; i < config->producers; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    for (size_t i = 0; i < config->consumers; i++) {
+        pthread_join(consumers[i], NULL);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    perf_stop(perf);
+
+    impl->teardown(channel);
+
+    printf("%s,%zu,%zu,%zu,%zu,%zu,%.6f,%.0f,%.4f", impl->name,
+           config->producers, config->consumers, config->message_size,
+           config->ring_size, config->messages, seconds,
+           config->messages / seconds,
+           config->messages * config->message_size / seconds / 1e9);
+    perf_print(perf, config->messages);
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_producers = 4;
+    size_t max_consumers = 4;
+    size_t bytes_per_run = 64 * 1024 * 1024;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "P:C:b:")) != -1) {
+        switch (opt) {
+            case 'P':
+                max_producers = strtoul(optarg, NULL, 10);
+                break;
+            case 'C':
+                max_consumers = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                bytes_per_run = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr,
+                        "Usage: %s [-P max_producers] [-C max_consumers] "
+                        "[-b bytes_per_run]\n",
+                        argv[0]);
+                exit(1);
+        }
+    }
+    if (max_producers < 1 || max_producers > MAX_THREADS ||
+        max_consumers < 1 || max_consumers > MAX_THREADS) {
+        fprintf(stderr, "Thread counts have to be between 1 and %d\n",
+                MAX_THREADS);
+        exit(1);
+    }
+
+    perf_t perf;
+    perf_open(&perf);
+
+    printf(
+        "impl,producers,consumers,message_size,ring_size,messages,seconds,"
+        "msgs_per_sec,gb_per_sec," PERF_CSV_HEADER "\n");
+
+    for (size_t p = 1; p <= max_producers; p *= 2) {
+        for (size_t c = 1; c <= max_consumers; c *= 2) {
+            for (size_t s = 0; s < sizeof(message_sizes) / sizeof(size_t);
+                 s++) {
+                for (size_t r = 0; r < sizeof(ring_sizes) / sizeof(size_t);
+                     r++) {
+                    config_t config = {p, c, message_sizes[s],
+                                       ring_sizes[r], 0};
+                    size_t messages = bytes_per_run / config.message_size;
+                    if (messages < 1000) {
+                        messages = 1000;
+                    }
+                    if (messages > 1000000) {
+                        messages = 1000000;
+                    }
+                    config.messages = messages - messages % (p * c);
+
+                    for (size_t i = 0; i < sizeof(impls) / sizeof(impl_t);
+                         i++) {
+                        if (supported(&impls[i], &config)) {
+                            run(&impls[i], &config, &perf);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    perf_close(&perf);
+    return 0;
+}
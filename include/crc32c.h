@@ -0,0 +1,49 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * CRC-32C (Castagnoli), computed with the SSE4.2 crc32 instruction when the
+ * cpu has it and with a lookup table otherwise. Both functions continue a
+ * running checksum: start with crc32c_init() and finish with
+ * crc32c_final().
+ */
+
+#define CRC32C_INIT 0xFFFFFFFFu
+
+static inline uint32_t crc32c_init(void) { return CRC32C_INIT; }
+
+static inline uint32_t crc32c_final(uint32_t crc) { return ~crc; }
+
+/**
+ * Update a checksum with the given data.
+ *
+ * @param crc running checksum
+ * @param data bytes to add
+ * @param len number of bytes
+ * @return the updated checksum
+ */
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t len);
+
+/**
+ * Copy bytes and update a checksum with them in the same pass.
+ *
+ * @param crc running checksum
+ * @param dst destination, must not overlap src
+ * @param src bytes to copy and add
+ * @param len number of bytes
+ * @return the updated checksum
+ */
+uint32_t crc32c_copy(uint32_t crc, void *dst, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CRC32C_H
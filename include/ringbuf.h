@@ -9,22 +9,167 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define SUCCESS 0
 #define RINGBUFFER_FULL 1
 #define RINGBUFFER_EMPTY 2
 #define OUTPUT_BUFFER_TOO_SMALL 3
+#define INVALID_MESSAGE_LENGTH 4
+#define CHECKSUM_MISMATCH 5
+#define RINGBUFFER_IO_ERROR 6  // details in errno
+#define RINGBUFFER_CLOSED 7    // see ringbuffer_close
 
 #define RBUF_TIMEOUT 1
 
+/* flags for ringbuffer_set_flags */
+#define RBUF_FLAG_STATS 0x1  // count traffic into the context's rbstats_t
+// Store a CRC-32C of every message and one of its header after its length
+// and verify them on read. Changes the framing, only switch it on an empty
+// ringbuffer. Slot mode records carry no header and are never checksummed.
+#define RBUF_FLAG_CHECKSUM 0x2
+// Never wait for space or data, fail with RINGBUFFER_FULL/EMPTY right away.
+// Meant for event loops driven by ringbuffer_readable_fd/writable_fd.
+#define RBUF_FLAG_NONBLOCK 0x4
+// Store the enqueue time of every message in its header, needed for
+// ringbuffer_set_codel and reported by ringbuffer_read_meta. Changes the
+// framing like RBUF_FLAG_CHECKSUM.
+#define RBUF_FLAG_TIMESTAMP 0x8
+// Store a deadline in the header of every message, see ringbuffer_write_ttl.
+// Changes the framing like RBUF_FLAG_CHECKSUM.
+#define RBUF_FLAG_EXPIRY 0x10
+
+#define RBUF_STATS_BUCKETS 24
+
+/*
+ * Traffic counters of a ringbuffer, see RBUF_FLAG_STATS.
+ * Bucket 0 of a blocked time histogram counts waits shorter than 1 us,
+ * bucket i > 0 waits of [2^(i-1), 2^i) us, the last bucket everything longer.
+ */
+typedef struct {
+    uint64_t messages_in;
+    uint64_t bytes_in;
+    uint64_t messages_out;
+    uint64_t bytes_out;
+    uint64_t full;        // writes that returned RINGBUFFER_FULL
+    uint64_t empty;       // reads that returned RINGBUFFER_EMPTY
+    uint64_t timeouts;    // waits that ran into RBUF_TIMEOUT
+    uint64_t high_water;  // most bytes stored at once
+    uint64_t spilled;     // messages written to the spill file
+    uint64_t dropped;     // messages shed by CoDel
+    uint64_t marked;      // messages marked by CoDel
+    uint64_t expired;     // messages skipped after their deadline
+    uint64_t write_blocked_us[RBUF_STATS_BUCKETS];
+    uint64_t read_blocked_us[RBUF_STATS_BUCKETS];
+} rbstats_t;
+
+#ifdef RINGBUF_LOCK_PROFILE
+/*
+ * Time one thread spent on the context lock, see RINGBUF_LOCK_PROFILE.
+ */
+typedef struct {
+    pthread_t thread;
+    uint64_t locks;
+    uint64_t acquire_ns;  // waiting for the mutex
+    uint64_t hold_ns;     // holding the mutex, excluding condition waits
+    uint64_t waits;
+    uint64_t wait_ns;  // in pthread_cond_timedwait
+} rblockprof_t;
+#endif
+
+/*
+ * State of the CoDel queue management, see ringbuffer_set_codel.
+ */
+typedef struct {
+    uint64_t target_ns;  // 0 when disabled
+    uint64_t interval_ns;
+    int mark;      // mark messages instead of dropping them
+    int dropping;  // in a shedding episode
+    uint64_t first_above_ns;
+    uint64_t drop_next_ns;
+    uint32_t count;
+    uint32_t last_count;
+} rbcodel_t;
+
+/*
+ * Per message information of ringbuffer_read_meta.
+ */
+typedef struct {
+    uint64_t enqueued_ns;  // CLOCK_MONOTONIC, 0 without RBUF_FLAG_TIMESTAMP
+    uint64_t sojourn_ns;   // time spent in the ringbuffer
+    int marked;            // CoDel asks to signal congestion
+} rbmeta_t;
+
+struct rbfile;
+struct rbwaiter;
+
 typedef struct {
     uint8_t *read;
     uint8_t *write;
     uint8_t *begin;
     uint8_t *end;  // 1 step AFTER the last readable address
+    size_t slot_size;  // 0 for length prefixed messages
+    int stream;        // raw bytes without message boundaries
+    int flags;
+    unsigned stats_seq;
+    rbstats_t stats;
+    rbcodel_t codel;
+    int readable_fd;  // eventfds, -1 until requested
+    int writable_fd;
+    int writer_starved;  // a write failed since the last writable_fd notify
+    struct rbwaiter *waiters;  // ringbuffer_poll calls waiting for data
+    struct rbfile *file;  // header of the mapping of ringbuffer_open, or NULL
+    int spill_fd;         // overflow file of ringbuffer_enable_spill, or -1
+    uint64_t spill_read;  // file offsets of the oldest and next message
+    uint64_t spill_write;
+    int spill_writers;      // appends to the file under way
+    int spill_reader;       // a reader is reading the file
+    uint8_t *spill_buffer;  // messages on their way back into the ring
+    int large_writer;  // a fragmented message is being written or read
+    int large_reader;
+    int closed;  // ringbuffer_close was called
+#ifdef RINGBUF_LOCK_PROFILE
+    uint64_t locked_at;
+    rblockprof_t *lock_profile;
+    size_t lock_profile_len;
+    size_t lock_profile_cap;
+#endif
     pthread_mutex_t mtx;
     pthread_cond_t sig;
+    pthread_mutex_t spill_mtx;  // serializes appends to the spill file
 } rbctx_t;
 
+/*
+ * Producer side handle that stages small messages in private memory and
+ * publishes them to the ringbuffer in batches, with a single lock and wakeup
+ * per batch. Not thread-safe, every producer thread uses its own.
+ */
+typedef struct {
+    rbctx_t *ring;
+    uint8_t *stage;  // [size_t length][message] records
+    size_t stage_size;
+    size_t staged_bytes;
+    size_t staged_messages;
+    size_t max_messages;    // 0 for no limit
+    uint64_t max_delay_us;  // 0 for no deadline
+    uint64_t first_staged_ns;
+} rbcoalesce_t;
+
+/*
+ * Producer side group of messages that is published all at once, see
+ * ringbuffer_txn_begin. Not thread-safe, every producer thread uses its own.
+ */
+typedef struct {
+    rbctx_t *ring;
+    uint8_t *stage;  // [size_t length][message] records
+    size_t stage_size;
+    size_t staged_bytes;
+    size_t staged_messages;
+    size_t footprint;  // ringbuffer space the group needs
+} rbtxn_t;
+
 /**
  * Initialize a thread-safe lock-free ringbuffer.
  * Generate ringbuffer context and memory before initialization.
@@ -36,16 +181,112 @@ typedef struct {
 void ringbuffer_init(rbctx_t *context, void *buffer_location,
                      size_t buffer_size);
 
+/**
+ * Initialize a ringbuffer of fixed size records.
+ * The memory is used as an array of slots, every message occupies exactly one
+ * slot and is stored without a length prefix. Trailing bytes that do not
+ * form a whole slot are left unused.
+ *
+ * @param context ringbuffer context.
+ * @param buffer_location the first byte location of the ringbuffer in memory
+ * @param buffer_size size of the ringbuffer (and memory)
+ * @param slot_size size of every record
+ */
+void ringbuffer_init_slots(rbctx_t *context, void *buffer_location,
+                           size_t buffer_size, size_t slot_size);
+
+/**
+ * Initialize a ringbuffer that carries a byte stream, like a pipe. Writes
+ * append their bytes without a length header, all of them or none, and reads
+ * return up to buffer_len of the bytes available, whichever writes they came
+ * from. RBUF_FLAG_CHECKSUM, TIMESTAMP and EXPIRY have no effect, spilling
+ * and fragmented messages are not available.
+ *
+ * @param context ringbuffer context.
+ * @param buffer_location the first byte location of the ringbuffer in memory
+ * @param buffer_size size of the ringbuffer (and memory)
+ */
+void ringbuffer_init_stream(rbctx_t *context, void *buffer_location,
+                            size_t buffer_size);
+
+/**
+ * Initialize a ringbuffer that lives in a memory mapped file, so messages
+ * survive a crash of the process. A new (or empty) file is sized to hold the
+ * ringbuffer and a small header, an existing one resumes at the read and write
+ * positions stored in its header, together with its RBUF_FLAG_CHECKSUM
+ * setting. The positions are updated after every complete message; the file
+ * is not synced, so it survives a crash of the process, not of the system.
+ * ringbuffer_destroy unmaps the file and leaves its contents in place.
+ *
+ * @param context ringbuffer context.
+ * @param path file to use, created if it does not exist
+ * @param buffer_size size of the ringbuffer, must match an existing file
+ * @return SUCCESS, or RINGBUFFER_IO_ERROR with errno set (EINVAL if the file
+ * is no ringbuffer of this size)
+ */
+int ringbuffer_open(rbctx_t *context, const char *path, size_t buffer_size);
+
+/**
+ * Let writes overflow into a file instead of waiting or failing when the
+ * ringbuffer is full. Once a message was spilled, all following messages are
+ * appended to the file too until it is drained, so the order is kept. Reads
+ * move spilled messages back into the ringbuffer as soon as it has room, so
+ * writes return to memory shortly after a burst; messages too large for the
+ * ringbuffer are read straight from the file once it is empty. The file is
+ * never read or written with the ringbuffer locked, a slow disk only stalls
+ * the threads doing the I/O. It is truncated whenever it runs empty.
+ * Messages carry no checksum, timestamp or deadline while spilled; they get a
+ * checksum and timestamp when moved back.
+ *
+ * Has to be called before the ringbuffer is shared with other threads, as it
+ * changes where writes go. The file is truncated now and closed by
+ * ringbuffer_destroy.
+ *
+ * @param context ringbuffer context
+ * @param path file to spill to, created if it does not exist
+ * @return SUCCESS, or RINGBUFFER_IO_ERROR with errno set (EINVAL for a
+ * stream ringbuffer)
+ */
+int ringbuffer_enable_spill(rbctx_t *context, const char *path);
+
+/**
+ * Enable optional features of a ringbuffer.
+ *
+ * @param context ringbuffer context
+ * @param flags bitwise or of RBUF_FLAG_* values, replaces the current flags
+ */
+void ringbuffer_set_flags(rbctx_t *context, int flags);
+
 /**
  * Write to the ringbuffer.
  *
  * @param context ringbuffer context
  * @param message The message to be placed in the ringbuffer
  * @param message_len size of the message
- * @return SUCESS on succes, RINGBUFFER_FULL when message doesn't fit
+ * @return SUCESS on succes, RINGBUFFER_FULL when message doesn't fit (right
+ * away when it could never fit without a spill file, see
+ * ringbuffer_write_large), INVALID_MESSAGE_LENGTH when message_len is not the
+ * slot size of a slot ringbuffer, RINGBUFFER_IO_ERROR when the spill file
+ * cannot be written,
+ * RINGBUFFER_CLOSED after ringbuffer_close
  */
 int ringbuffer_write(rbctx_t *context, void *message, size_t message_len);
 
+/**
+ * Write to the ringbuffer a message that is only worth reading within ttl_us.
+ * Reads skip expired messages without copying them, reclaiming all expired
+ * messages in front of the next live one at once. Needs RBUF_FLAG_EXPIRY,
+ * without it (and in slot mode or when spilled) the TTL is ignored.
+ *
+ * @param context ringbuffer context
+ * @param message The message to be placed in the ringbuffer
+ * @param message_len size of the message
+ * @param ttl_us lifetime of the message from now, 0 for no expiry
+ * @return as ringbuffer_write
+ */
+int ringbuffer_write_ttl(rbctx_t *context, void *message, size_t message_len,
+                         uint64_t ttl_us);
+
 /**
  * Read from the ringbuffer.
  *
@@ -54,16 +295,290 @@ int ringbuffer_write(rbctx_t *context, void *message, size_t message_len);
  * @param buffer_len_ptr size of the message buffer. Size of message received
  * from ringbuffer is stored here
  * @return SUCCESS on succes, RINGBUFFER_EMPTY if no data to read,
- * OUTPUT_BUFFER_TOO_SMALL when read message doesn't fit
+ * OUTPUT_BUFFER_TOO_SMALL when read message doesn't fit; it is not consumed
+ * and a retry with a large enough buffer returns it,
+ * CHECKSUM_MISMATCH when the message was read but is corrupted
+ * (RBUF_FLAG_CHECKSUM) or its header is, then the start of the next message
+ * is unknown and everything in the ringbuffer is dropped,
+ * RINGBUFFER_CLOSED once closed and drained
  */
 int ringbuffer_read(rbctx_t *context, void *buffer, size_t *buffer_len_ptr);
 
+/**
+ * Write a message of any size, also larger than the ringbuffer, as a series
+ * of fragments that ringbuffer_read_large reassembles. Fragments are written
+ * as soon as there is room and are never interleaved with fragments of other
+ * messages. Once the first fragment is written, the call waits for readers
+ * as long as it takes to write the rest, even with RBUF_FLAG_NONBLOCK.
+ *
+ * A ringbuffer carrying fragmented messages has to be written with this
+ * function and read with ringbuffer_read_large only. Fragments are never
+ * shed. They cannot be spilled either: with a spill file, ringbuffer_write
+ * takes messages of any size instead.
+ *
+ * @param context ringbuffer context
+ * @param message message to write
+ * @param message_len size of the message
+ * @return SUCCESS on success, RINGBUFFER_FULL if no room for the first
+ * fragment was made in time, INVALID_MESSAGE_LENGTH in slot or stream mode
+ * and with a spill file,
+ * RINGBUFFER_CLOSED when closed before the message was complete
+ */
+int ringbuffer_write_large(rbctx_t *context, void *message,
+                           size_t message_len);
+
+/**
+ * Read a message of ringbuffer_write_large, collecting its fragments. Once
+ * the first fragment is read, waits for the others as long as it takes or
+ * until ringbuffer_close.
+ *
+ * @param context ringbuffer context
+ * @param buffer reads to this location
+ * @param buffer_len size of the buffer, set to the size of the message. On
+ * OUTPUT_BUFFER_TOO_SMALL set to the size needed, the message stays in place
+ * @return as ringbuffer_read, CHECKSUM_MISMATCH when any fragment is corrupted,
+ * INVALID_MESSAGE_LENGTH when the next message was not written with
+ * ringbuffer_write_large (it stays in place)
+ */
+int ringbuffer_read_large(rbctx_t *context, void *buffer, size_t *buffer_len);
+
+/**
+ * Initialize a coalescing producer for a ringbuffer. Messages are staged until
+ * the staging memory is full, max_messages are staged, or the oldest staged
+ * message is older than max_delay_us, then all of them are published at once.
+ * The deadline is checked on every write and ringbuffer_coalesce_poll; a
+ * producer that goes idle must poll or flush.
+ *
+ * @param coalescer coalescing producer context
+ * @param context ringbuffer to publish to
+ * @param stage_location memory to stage messages in, with a size_t per message
+ * @param stage_size size of the staging memory
+ * @param max_messages publish once this many messages are staged, 0 for no
+ * limit
+ * @param max_delay_us publish once the oldest message waited this long, 0 for
+ * no deadline
+ */
+void ringbuffer_coalesce_init(rbcoalesce_t *coalescer, rbctx_t *context,
+                              void *stage_location, size_t stage_size,
+                              size_t max_messages, uint64_t max_delay_us);
+
+/**
+ * Stage a message, publishing the batch if a threshold is reached. Messages
+ * too large for the staging memory are written directly after the staged
+ * ones.
+ *
+ * @param coalescer coalescing producer context
+ * @param message The message to be placed in the ringbuffer
+ * @param message_len size of the message
+ * @return SUCCESS when the message was staged or written, RINGBUFFER_FULL if
+ * it could not be staged because the staged messages do not fit the
+ * ringbuffer, INVALID_MESSAGE_LENGTH as for ringbuffer_write
+ */
+int ringbuffer_coalesce_write(rbcoalesce_t *coalescer, void *message,
+                              size_t message_len);
+
+/**
+ * Publish the staged messages if the oldest one is past its deadline.
+ *
+ * @param coalescer coalescing producer context
+ * @return as ringbuffer_flush, SUCCESS if nothing was due
+ */
+int ringbuffer_coalesce_poll(rbcoalesce_t *coalescer);
+
+/**
+ * Publish all staged messages under one lock, waking readers once. Messages
+ * that do not fit stay staged, in order.
+ *
+ * @param coalescer coalescing producer context
+ * @return SUCCESS when everything was published, RINGBUFFER_FULL or
+ * RINGBUFFER_CLOSED otherwise
+ */
+int ringbuffer_flush(rbcoalesce_t *coalescer);
+
+/**
+ * Start a transaction: messages appended to it are staged in the given memory
+ * and only become visible to readers together, on commit, without messages of
+ * other producers in between.
+ *
+ * @param txn transaction to start, any previous content is discarded
+ * @param context ringbuffer context
+ * @param stage_location staging memory, needs sizeof(size_t) per message on
+ * top of the messages
+ * @param stage_size size of the staging memory
+ */
+void ringbuffer_txn_begin(rbtxn_t *txn, rbctx_t *context, void *stage_location,
+                          size_t stage_size);
+
+/**
+ * Add a message to a transaction.
+ *
+ * @param txn started transaction
+ * @param message message to stage
+ * @param message_len size of the message
+ * @return SUCCESS on success, RINGBUFFER_FULL when the message does not fit
+ * the staging memory or the group would not fit the ringbuffer,
+ * INVALID_MESSAGE_LENGTH as for ringbuffer_write. The transaction stays
+ * usable either way.
+ */
+int ringbuffer_txn_append(rbtxn_t *txn, void *message, size_t message_len);
+
+/**
+ * Publish all messages of a transaction under one lock, waking readers once.
+ * Waits up to RBUF_TIMEOUT for room for the whole group; either all messages
+ * are written or none.
+ *
+ * @param txn started transaction, empty again on success
+ * @return SUCCESS on success, RINGBUFFER_FULL if the group did not fit in
+ * time (the transaction is kept for another commit), RINGBUFFER_IO_ERROR if
+ * spilling failed, RINGBUFFER_CLOSED after ringbuffer_close
+ */
+int ringbuffer_txn_commit(rbtxn_t *txn);
+
+/**
+ * Discard all messages of a transaction.
+ *
+ * @param txn started transaction, empty afterwards
+ */
+void ringbuffer_txn_abort(rbtxn_t *txn);
+
+/**
+ * Read from the ringbuffer like ringbuffer_read, also reporting when the
+ * message was enqueued and whether CoDel marked it.
+ *
+ * @param context ringbuffer context
+ * @param buffer reads to this location
+ * @param buffer_len size of the buffer, set to the size of the message
+ * @param meta set to the information about the message
+ * @return as ringbuffer_read
+ */
+int ringbuffer_read_meta(rbctx_t *context, void *buffer, size_t *buffer_len,
+                         rbmeta_t *meta);
+
+/*
+ * Visitor of ringbuffer_consume. A message that wraps around the end of the
+ * ringbuffer arrives in two spans, otherwise wrapped is NULL and wrapped_len
+ * 0. Return nonzero to stop after this message.
+ */
+typedef int (*rbvisitor_t)(void *user, const void *data, size_t len,
+                           const void *wrapped, size_t wrapped_len);
+
+/**
+ * Consume up to max_messages messages in place: the visitor gets spans
+ * pointing directly into ringbuffer memory, and the space of all visited
+ * messages is released at once afterwards. Avoids the copy and the buffer
+ * sized for the largest message of ringbuffer_read for consumers that only
+ * parse or forward data. Never waits for data.
+ *
+ * The visitor runs with the ringbuffer locked, so it has to be short and must
+ * not call into the same ringbuffer. Spans are only valid during the call.
+ * Shed and corrupted (RBUF_FLAG_CHECKSUM) messages are skipped. Spilled
+ * messages are moved back into the ringbuffer first, those too large for it
+ * are visited through a temporary copy.
+ *
+ * @param context ringbuffer context
+ * @param max_messages upper bound of messages to visit
+ * @param visitor called once per message
+ * @param user passed to the visitor
+ * @return the number of messages visited, 0 when the ringbuffer is empty
+ */
+int ringbuffer_consume(rbctx_t *context, size_t max_messages,
+                       rbvisitor_t visitor, void *user);
+
+/**
+ * Bound the queueing delay with CoDel (RFC 8289). When messages spent more
+ * than target_us in the ringbuffer for at least interval_us, reads start to
+ * shed messages at an increasing rate until the delay falls below the target.
+ * Shed messages are dropped, or delivered as marked in rbmeta_t. Needs
+ * RBUF_FLAG_TIMESTAMP, messages without timestamp (slot mode, too large to
+ * leave the spill file) are never shed.
+ *
+ * @param context ringbuffer context
+ * @param target_us acceptable standing queueing delay, 0 disables CoDel
+ * @param interval_us how long the delay may stay above the target, in the
+ * order of a consumer's round trip (e.g. 100000)
+ * @param mark nonzero to mark instead of drop
+ */
+void ringbuffer_set_codel(rbctx_t *context, uint64_t target_us,
+                          uint64_t interval_us, int mark);
+
+/**
+ * Eventfd that becomes readable when the ringbuffer goes from empty to
+ * non-empty, for use with epoll/poll/select. It is created on the first call
+ * and closed by ringbuffer_destroy. Notifications are coalesced: after
+ * reading the eventfd, read messages until RINGBUFFER_EMPTY, the next write
+ * then notifies again.
+ *
+ * @param context ringbuffer context
+ * @return the file descriptor, -1 if it could not be created
+ */
+int ringbuffer_readable_fd(rbctx_t *context);
+
+/**
+ * Eventfd that becomes readable when a message was read after a write failed
+ * with RINGBUFFER_FULL, i.e. when it is worth retrying the write.
+ *
+ * @param context ringbuffer context
+ * @return the file descriptor, -1 if it could not be created
+ */
+int ringbuffer_writable_fd(rbctx_t *context);
+
+/**
+ * Tell readers and writers that no more data is coming. Every waiting thread
+ * wakes up right away, including ringbuffer_poll calls and event loops on the
+ * eventfds. Afterwards writes fail with RINGBUFFER_CLOSED, and reads return
+ * what is left and then RINGBUFFER_CLOSED instead of RINGBUFFER_EMPTY. A
+ * fragmented message of ringbuffer_write_large that is not complete yet is
+ * cut short. ringbuffer_consume only visits what is left, a closed and
+ * drained ringbuffer looks empty to it.
+ *
+ * @param context ringbuffer context
+ */
+void ringbuffer_close(rbctx_t *context);
+
+/**
+ * Wait until any of the given ringbuffers has something to read. Each
+ * ringbuffer links a waiter to one notification shared by the call, so a
+ * single write wakes it without polling. Readiness is a snapshot: another
+ * reader may take the message first, so read with RBUF_FLAG_NONBLOCK or
+ * expect RINGBUFFER_EMPTY.
+ *
+ * @param rings ringbuffers to wait on
+ * @param nr_of_rings number of ringbuffers
+ * @param timeout_ms longest time to wait, 0 to only check, -1 for no limit
+ * @param ready set to 1 for every ringbuffer with data or closed, 0 otherwise
+ * @return number of ready ringbuffers, 0 on timeout, -1 if out of memory
+ */
+int ringbuffer_poll(rbctx_t **rings, size_t nr_of_rings, int timeout_ms,
+                    int *ready);
+
+/**
+ * Take a consistent snapshot of the statistics without blocking readers or
+ * writers. Counters only move while RBUF_FLAG_STATS is set.
+ *
+ * @param context ringbuffer context
+ * @param stats receives the counters
+ */
+void ringbuffer_stats(rbctx_t *context, rbstats_t *stats);
+
+/**
+ * Absolute time RBUF_TIMEOUT seconds from now, the deadline of every timed
+ * wait on a ringbuffer.
+ *
+ * @return the deadline to pass to pthread_cond_timedwait
+ */
+struct timespec get_abstime();
+
 /**
  * Frees all memory allocated and syncronization variables created during
- * initialization.
+ * initialization. When built with RINGBUF_LOCK_PROFILE (make LOCK_PROFILE=1)
+ * the per thread lock profile is printed to stderr first.
  *
  * @param context ringbuffer context
  */
 void ringbuffer_destroy(rbctx_t *context);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif  // RINGBUF_H
@@ -0,0 +1,203 @@
+#ifndef RINGBUF_HPP
+#define RINGBUF_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "ringbuf.h"
+
+namespace rb {
+
+enum class Producers { Single, Multi };
+enum class Consumers { Single, Multi };
+
+/*
+ * What push/pop/emplace do when the ring is full or empty. The try_* variants
+ * never wait, so with Wait::None only those are available.
+ */
+enum class Wait { None, Spin, Block };
+
+template <Producers P, Consumers C, Wait W>
+struct Policy {
+    static constexpr Producers producers = P;
+    static constexpr Consumers consumers = C;
+    static constexpr Wait wait = W;
+};
+
+using SpscSpin = Policy<Producers::Single, Consumers::Single, Wait::Spin>;
+using SpscBlock = Policy<Producers::Single, Consumers::Single, Wait::Block>;
+using MpscBlock = Policy<Producers::Multi, Consumers::Single, Wait::Block>;
+using MpmcBlock = Policy<Producers::Multi, Consumers::Multi, Wait::Block>;
+
+/*
+ * Typed ringbuffer of Capacity elements of T. Elements are constructed in
+ * place inside the ring and moved out on pop, there is no byte copy and no
+ * length prefix.
+ *
+ * Indices are free running counters masked with the compile time capacity.
+ * A single producer or consumer side is lock-free, a multi side serializes on
+ * the mutex of the underlying rbctx_t, whose condition variable also backs
+ * Wait::Block. The context is destroyed with ringbuffer_destroy together with
+ * the ring.
+ */
+template <typename T, std::size_t Capacity, typename P = MpmcBlock>
+class Ring {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+   public:
+    using value_type = T;
+    using policy = P;
+
+    Ring() {
+        ringbuffer_init(&context_, storage_, sizeof(storage_));
+    }
+
+    ~Ring() {
+        while (try_pop()) {
+        }
+        ringbuffer_destroy(&context_);
+    }
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    std::size_t size() const {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    template <typename... Args>
+    bool try_emplace(Args &&...args) {
+        bool pushed;
+        {
+            Guard<P::producers == Producers::Multi> guard(&context_.mtx);
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+            ::new (slot(head)) T(std::forward<Args>(args)...);
+            head_.store(head + 1, std::memory_order_release);
+            pushed = true;
+        }
+        notify();
+        return pushed;
+    }
+
+    bool try_push(T &&value) { return try_emplace(std::move(value)); }
+    bool try_push(const T &value) { return try_emplace(value); }
+
+    std::optional<T> try_pop() {
+        std::optional<T> value;
+        {
+            Guard<P::consumers == Consumers::Multi> guard(&context_.mtx);
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_.load(std::memory_order_acquire)) {
+                return value;
+            }
+            T *element = std::launder(reinterpret_cast<T *>(slot(tail)));
+            value.emplace(std::move(*element));
+            element->~T();
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+        notify();
+        return value;
+    }
+
+    template <typename... Args>
+    void emplace(Args &&...args) {
+        static_assert(P::wait != Wait::None, "Wait::None only supports try_*");
+        // Arguments are only forwarded by the attempt that succeeds
+        wait_until([&] { return size() < Capacity; },
+                   [&] { return try_emplace(std::forward<Args>(args)...); });
+    }
+
+    void push(T &&value) { emplace(std::move(value)); }
+    void push(const T &value) { emplace(value); }
+
+    T pop() {
+        static_assert(P::wait != Wait::None, "Wait::None only supports try_*");
+        std::optional<T> value;
+        wait_until([&] { return !empty(); },
+                   [&] {
+                       std::optional<T> popped = try_pop();
+                       if (popped) {
+                           value.emplace(std::move(*popped));
+                       }
+                       return popped.has_value();
+                   });
+        return std::move(*value);
+    }
+
+   private:
+    template <bool Enabled>
+    struct Guard {
+        explicit Guard(pthread_mutex_t *mtx) : mtx_(mtx) {
+            if constexpr (Enabled) {
+                pthread_mutex_lock(mtx_);
+            }
+        }
+        ~Guard() {
+            if constexpr (Enabled) {
+                pthread_mutex_unlock(mtx_);
+            }
+        }
+        pthread_mutex_t *mtx_;
+    };
+
+    void *slot(std::size_t index) {
+        return storage_ + (index & (Capacity - 1)) * sizeof(T);
+    }
+
+    void notify() {
+        if constexpr (P::wait == Wait::Block) {
+            // Pairs with the fence in wait_until: either the waiter sees the
+            // new index or we see the waiter. Taking the lock orders the
+            // wakeup after the waiter's check.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters_.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+            pthread_mutex_lock(&context_.mtx);
+            pthread_cond_broadcast(&context_.sig);
+            pthread_mutex_unlock(&context_.mtx);
+        }
+    }
+
+    template <typename Ready, typename Attempt>
+    void wait_until(Ready ready, Attempt attempt) {
+        while (!attempt()) {
+            if constexpr (P::wait == Wait::Block) {
+                pthread_mutex_lock(&context_.mtx);
+                waiters_.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!ready()) {
+                    pthread_cond_wait(&context_.sig, &context_.mtx);
+                }
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+                pthread_mutex_unlock(&context_.mtx);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::atomic<int> waiters_{0};
+    alignas(64) rbctx_t context_;
+    alignas(T) unsigned char storage_[Capacity * sizeof(T)];
+};
+
+}  // namespace rb
+
+#endif  // RINGBUF_HPP
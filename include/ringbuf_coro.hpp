@@ -0,0 +1,215 @@
+#ifndef RINGBUF_CORO_HPP
+#define RINGBUF_CORO_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "ringbuf.hpp"
+
+namespace rb {
+
+/*
+ * Decides where a coroutine suspended on a CoRing continues once its push or
+ * pop completed. schedule() is called without any ring lock held, from the
+ * thread that made the operation complete.
+ */
+class Scheduler {
+   public:
+    virtual ~Scheduler() = default;
+    virtual void schedule(std::coroutine_handle<> handle) = 0;
+};
+
+/*
+ * Resumes the coroutine right away on the completing thread. Simple, but a
+ * chain of coroutines waking each other grows the stack, so event loops and
+ * thread pools should provide their own Scheduler.
+ */
+class InlineScheduler : public Scheduler {
+   public:
+    void schedule(std::coroutine_handle<> handle) override { handle.resume(); }
+
+    static InlineScheduler &instance() {
+        static InlineScheduler scheduler;
+        return scheduler;
+    }
+};
+
+/*
+ * Ring whose push and pop are awaitables: co_await ring.pop() suspends the
+ * calling coroutine, not the thread, while the ring is empty, and
+ * co_await ring.push(value) while it is full. Any number of coroutines on any
+ * number of threads may wait on the same ring.
+ *
+ * Suspended operations queue up in FIFO order and are completed by the
+ * operation that unblocks them: a push hands its value directly to the oldest
+ * waiting pop, a pop moves the oldest waiting push into the freed slot. The
+ * waiting coroutine is then passed to the Scheduler, so it never has to retry
+ * and cannot be starved. Waiters only exist on one side at a time, so this
+ * keeps the ring FIFO.
+ *
+ * Awaitables must be awaited right away and only once.
+ */
+template <typename T, std::size_t Capacity>
+class CoRing {
+    // All ring accesses happen under mtx_, so the ring itself needs no locking
+    using Storage =
+        Ring<T, Capacity, Policy<Producers::Single, Consumers::Single, Wait::None>>;
+
+    struct Waiter {
+        Waiter *next = nullptr;
+        std::coroutine_handle<> handle;
+    };
+
+    struct WaitQueue {
+        void push(Waiter *waiter) {
+            waiter->next = nullptr;
+            if (tail) {
+                tail->next = waiter;
+            } else {
+                head = waiter;
+            }
+            tail = waiter;
+        }
+
+        Waiter *pop() {
+            Waiter *waiter = head;
+            if (waiter) {
+                head = waiter->next;
+                if (!head) {
+                    tail = nullptr;
+                }
+            }
+            return waiter;
+        }
+
+        Waiter *head = nullptr;
+        Waiter *tail = nullptr;
+    };
+
+   public:
+    class PushAwaiter : Waiter {
+       public:
+        bool await_ready() { return ring_.try_push_now(this); }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            this->handle = handle;
+            return ring_.suspend_push(this);
+        }
+
+        void await_resume() {}
+
+       private:
+        friend class CoRing;
+        PushAwaiter(CoRing &ring, T &&value)
+            : ring_(ring), value_(std::move(value)) {}
+
+        CoRing &ring_;
+        T value_;
+    };
+
+    class PopAwaiter : Waiter {
+       public:
+        bool await_ready() { return ring_.try_pop_now(this); }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            this->handle = handle;
+            return ring_.suspend_pop(this);
+        }
+
+        T await_resume() { return std::move(*value_); }
+
+       private:
+        friend class CoRing;
+        explicit PopAwaiter(CoRing &ring) : ring_(ring) {}
+
+        CoRing &ring_;
+        std::optional<T> value_;
+    };
+
+    explicit CoRing(Scheduler &scheduler = InlineScheduler::instance())
+        : scheduler_(scheduler) {}
+
+    CoRing(const CoRing &) = delete;
+    CoRing &operator=(const CoRing &) = delete;
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    std::size_t size() const { return ring_.size(); }
+
+    PushAwaiter push(T value) { return PushAwaiter(*this, std::move(value)); }
+
+    PopAwaiter pop() { return PopAwaiter(*this); }
+
+   private:
+    using Lock = std::unique_lock<std::mutex>;
+
+    /*
+     * Complete a push or pop without waiting, with the lock held. Returns
+     * false if the caller has to queue up. A woken waiter is scheduled after
+     * dropping the lock.
+     */
+    bool complete_push(Lock &lock, PushAwaiter *awaiter) {
+        if (PopAwaiter *popper = static_cast<PopAwaiter *>(poppers_.pop())) {
+            popper->value_.emplace(std::move(awaiter->value_));
+            lock.unlock();
+            scheduler_.schedule(popper->handle);
+            return true;
+        }
+        return ring_.try_push(std::move(awaiter->value_));
+    }
+
+    bool complete_pop(Lock &lock, PopAwaiter *awaiter) {
+        awaiter->value_ = ring_.try_pop();
+        if (!awaiter->value_) {
+            return false;
+        }
+        if (PushAwaiter *pusher = static_cast<PushAwaiter *>(pushers_.pop())) {
+            ring_.try_push(std::move(pusher->value_));
+            lock.unlock();
+            scheduler_.schedule(pusher->handle);
+        }
+        return true;
+    }
+
+    bool try_push_now(PushAwaiter *awaiter) {
+        Lock lock(mtx_);
+        return complete_push(lock, awaiter);
+    }
+
+    bool suspend_push(PushAwaiter *awaiter) {
+        Lock lock(mtx_);
+        // Something may have been popped since await_ready
+        if (complete_push(lock, awaiter)) {
+            return false;
+        }
+        pushers_.push(awaiter);
+        return true;
+    }
+
+    bool try_pop_now(PopAwaiter *awaiter) {
+        Lock lock(mtx_);
+        return complete_pop(lock, awaiter);
+    }
+
+    bool suspend_pop(PopAwaiter *awaiter) {
+        Lock lock(mtx_);
+        if (complete_pop(lock, awaiter)) {
+            return false;
+        }
+        poppers_.push(awaiter);
+        return true;
+    }
+
+    Scheduler &scheduler_;
+    std::mutex mtx_;
+    WaitQueue pushers_;
+    WaitQueue poppers_;
+    Storage ring_;
+};
+
+}  // namespace rb
+
+#endif  // RINGBUF_CORO_HPP
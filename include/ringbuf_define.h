@@ -0,0 +1,224 @@
+#ifndef RINGBUF_DEFINE_H
+#define RINGBUF_DEFINE_H
+
+#include <stdatomic.h>
+
+#include "ringbuf.h"
+
+/*
+ * RINGBUF_DEFINE(name, element_type, capacity, mode) emits a ringbuffer type
+ * name##_t specialized for one element type with a compile time capacity,
+ * together with static inline functions:
+ *
+ *   void   name##_init(name##_t *ring);
+ *   int    name##_write(name##_t *ring, const element_type *element);
+ *   int    name##_read(name##_t *ring, element_type *element);
+ *   size_t name##_write_n(name##_t *ring, const element_type *elements,
+ *                         size_t n);
+ *   size_t name##_read_n(name##_t *ring, element_type *elements, size_t n);
+ *   size_t name##_size(name##_t *ring);
+ *   void   name##_destroy(name##_t *ring);
+ *
+ * write/read return SUCCESS, RINGBUFFER_FULL or RINGBUFFER_EMPTY like the
+ * rbctx_t functions, the _n variants move up to n elements at once and return
+ * how many were moved. The capacity has to be a power of two, so index math
+ * folds into a mask and copies have a constant size.
+ *
+ * mode is one of
+ *   SPSC    lock-free, for exactly one writer and one reader thread
+ *   LOCKED  any number of threads, a full ring makes writes wait up to
+ *           RBUF_TIMEOUT like ringbuffer_write
+ */
+#define RINGBUF_DEFINE(name, element_type, capacity, mode) \
+    RINGBUF_DEFINE_##mode(name, element_type, capacity)
+
+#define RINGBUF_DEFINE_COMMON(name, element_type, capacity)                   \
+    _Static_assert((capacity) > 0 && ((capacity) & ((capacity)-1)) == 0,      \
+                   #name ": capacity must be a power of two");                \
+                                                                              \
+    static inline void name##_copy_in(element_type *slots, size_t head,       \
+                                      const element_type *elements,           \
+                                      size_t n) {                             \
+        size_t first = (size_t)(capacity) - (head & ((capacity)-1));          \
+        if (first > n) {                                                      \
+            first = n;                                                        \
+        }                                                                     \
+        memcpy(&slots[head & ((capacity)-1)], elements,                       \
+               first * sizeof(element_type));                                 \
+        memcpy(slots, elements + first, (n - first) * sizeof(element_type));  \
+    }                                                                         \
+                                                                              \
+    static inline void name##_copy_out(const element_type *slots,             \
+                                       size_t tail, element_type *elements,   \
+                                       size_t n) {                            \
+        size_t first = (size_t)(capacity) - (tail & ((capacity)-1));          \
+        if (first > n) {                                                      \
+            first = n;                                                        \
+        }                                                                     \
+        memcpy(elements, &slots[tail & ((capacity)-1)],                       \
+               first * sizeof(element_type));                                 \
+        memcpy(elements + first, slots, (n - first) * sizeof(element_type));  \
+    }
+
+// Free running head/tail counters on separate cache lines, the producer only
+// stores head and the consumer only stores tail.
+#define RINGBUF_DEFINE_SPSC(name, element_type, capacity)                      \
+    RINGBUF_DEFINE_COMMON(name, element_type, capacity)                        \
+                                                                               \
+    typedef struct {                                                           \
+        _Alignas(64) _Atomic size_t head;                                      \
+        _Alignas(64) _Atomic size_t tail;                                      \
+        _Alignas(64) element_type slots[capacity];                             \
+    } name##_t;                                                                \
+                                                                               \
+    static inline void name##_init(name##_t *ring) {                           \
+        atomic_init(&ring->head, 0);                                           \
+        atomic_init(&ring->tail, 0);                                           \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_size(name##_t *ring) {                         \
+        return atomic_load_explicit(&ring->head, memory_order_acquire) -       \
+               atomic_load_explicit(&ring->tail, memory_order_acquire);        \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_write_n(name##_t *ring,                        \
+                                        const element_type *elements,          \
+                                        size_t n) {                            \
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed); \
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire); \
+        size_t free_slots = (size_t)(capacity) - (head - tail);                \
+        if (n > free_slots) {                                                  \
+            n = free_slots;                                                    \
+        }                                                                      \
+        name##_copy_in(ring->slots, head, elements, n);                        \
+        atomic_store_explicit(&ring->head, head + n, memory_order_release);    \
+        return n;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_read_n(name##_t *ring,                         \
+                                       element_type *elements, size_t n) {     \
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed); \
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire); \
+        if (n > head - tail) {                                                 \
+            n = head - tail;                                                   \
+        }                                                                      \
+        name##_copy_out(ring->slots, tail, elements, n);                       \
+        atomic_store_explicit(&ring->tail, tail + n, memory_order_release);    \
+        return n;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline int name##_write(name##_t *ring,                             \
+                                   const element_type *element) {              \
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed); \
+        if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) ==  \
+            (capacity)) {                                                      \
+            return RINGBUFFER_FULL;                                            \
+        }                                                                      \
+        ring->slots[head & ((capacity)-1)] = *element;                         \
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release);    \
+        return SUCCESS;                                                        \
+    }                                                                          \
+                                                                               \
+    static inline int name##_read(name##_t *ring, element_type *element) {     \
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed); \
+        if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) { \
+            return RINGBUFFER_EMPTY;                                           \
+        }                                                                      \
+        *element = ring->slots[tail & ((capacity)-1)];                         \
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);    \
+        return SUCCESS;                                                        \
+    }                                                                          \
+                                                                               \
+    static inline void name##_destroy(name##_t *ring) { (void)ring; }
+
+#define RINGBUF_DEFINE_LOCKED(name, element_type, capacity)                 \
+    RINGBUF_DEFINE_COMMON(name, element_type, capacity)                     \
+                                                                            \
+    typedef struct {                                                        \
+        size_t head;                                                        \
+        size_t tail;                                                        \
+        pthread_mutex_t mtx;                                                \
+        pthread_cond_t sig;                                                 \
+        element_type slots[capacity];                                       \
+    } name##_t;                                                             \
+                                                                            \
+    static inline void name##_init(name##_t *ring) {                        \
+        ring->head = 0;                                                     \
+        ring->tail = 0;                                                     \
+        pthread_mutex_init(&ring->mtx, NULL);                               \
+        pthread_cond_init(&ring->sig, NULL);                                \
+    }                                                                       \
+                                                                            \
+    static inline size_t name##_size(name##_t *ring) {                      \
+        pthread_mutex_lock(&ring->mtx);                                     \
+        size_t size = ring->head - ring->tail;                              \
+        pthread_mutex_unlock(&ring->mtx);                                   \
+        return size;                                                        \
+    }                                                                       \
+                                                                            \
+    static inline size_t name##_write_n(name##_t *ring,                     \
+                                        const element_type *elements,       \
+                                        size_t n) {                         \
+        pthread_mutex_lock(&ring->mtx);                                     \
+        size_t free_slots = (size_t)(capacity) - (ring->head - ring->tail); \
+        if (n > free_slots) {                                               \
+            n = free_slots;                                                 \
+        }                                                                   \
+        name##_copy_in(ring->slots, ring->head, elements, n);               \
+        ring->head += n;                                                    \
+        pthread_cond_broadcast(&ring->sig);                                 \
+        pthread_mutex_unlock(&ring->mtx);                                   \
+        return n;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline size_t name##_read_n(name##_t *ring,                      \
+                                       element_type *elements, size_t n) {  \
+        pthread_mutex_lock(&ring->mtx);                                     \
+        if (n > ring->head - ring->tail) {                                  \
+            n = ring->head - ring->tail;                                    \
+        }                                                                   \
+        name##_copy_out(ring->slots, ring->tail, elements, n);              \
+        ring->tail += n;                                                    \
+        pthread_cond_broadcast(&ring->sig);                                 \
+        pthread_mutex_unlock(&ring->mtx);                                   \
+        return n;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline int name##_write(name##_t *ring,                          \
+                                   const element_type *element) {           \
+        pthread_mutex_lock(&ring->mtx);                                     \
+        while (ring->head - ring->tail == (capacity)) {                     \
+            struct timespec abstime = get_abstime();                        \
+            if (pthread_cond_timedwait(&ring->sig, &ring->mtx, &abstime) != \
+                    0 &&                                                    \
+                ring->head - ring->tail == (capacity)) {                    \
+                pthread_mutex_unlock(&ring->mtx);                           \
+                return RINGBUFFER_FULL;                                     \
+            }                                                               \
+        }                                                                   \
+        ring->slots[ring->head & ((capacity)-1)] = *element;                \
+        ring->head++;                                                       \
+        pthread_cond_signal(&ring->sig);                                    \
+        pthread_mutex_unlock(&ring->mtx);                                   \
+        return SUCCESS;                                                     \
+    }                                                                       \
+                                                                            \
+    static inline int name##_read(name##_t *ring, element_type *element) {  \
+        pthread_mutex_lock(&ring->mtx);                                     \
+        if (ring->head == ring->tail) {                                     \
+            pthread_mutex_unlock(&ring->mtx);                               \
+            return RINGBUFFER_EMPTY;                                        \
+        }                                                                   \
+        *element = ring->slots[ring->tail & ((capacity)-1)];                \
+        ring->tail++;                                                       \
+        pthread_cond_signal(&ring->sig);                                    \
+        pthread_mutex_unlock(&ring->mtx);                                   \
+        return SUCCESS;                                                     \
+    }                                                                       \
+                                                                            \
+    static inline void name##_destroy(name##_t *ring) {                     \
+        pthread_mutex_destroy(&ring->mtx);                                  \
+        pthread_cond_destroy(&ring->sig);                                   \
+    }
+
+#endif  // RINGBUF_DEFINE_H
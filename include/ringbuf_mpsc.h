@@ -0,0 +1,100 @@
+#ifndef RINGBUF_MPSC_H
+#define RINGBUF_MPSC_H
+
+#include "ringbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free ring of variable length records for many producers and a single
+ * consumer, after the Linux BPF ringbuf. Producers reserve space with a CAS
+ * on the producer position, fill the record in place and commit it; the
+ * consumer reads committed records in order and stops at the first one still
+ * being filled. Nobody ever takes a lock, so a preempted producer only holds
+ * back the records behind its own.
+ *
+ * Every record starts with an 8 byte header holding its length and the busy,
+ * valid and discard bits, and is padded to a multiple of 8. A record that
+ * would wrap is preceded by a discarded padding record up to the end of the
+ * memory, so records are always contiguous. The consumer zeroes what it
+ * consumed: a header that is still 0 marks space a producer reserved but did
+ * not get to write yet.
+ *
+ * Positions only ever grow, the offset into the memory is position & mask.
+ */
+typedef struct {
+    uint8_t *begin;
+    uint64_t mask;  // size - 1, the size is a power of 2
+    uint64_t producer_pos __attribute__((aligned(64)));
+    uint64_t consumer_pos __attribute__((aligned(64)));
+} rbmpsc_t;
+
+/**
+ * Initialize a ring on top of the given memory.
+ *
+ * @param ring ring context
+ * @param ring_location the first byte location of the ring in memory,
+ * 8 byte aligned
+ * @param ring_size size of the memory, rounded down to a power of 2 of at
+ * least 16
+ */
+void ringbuffer_mpsc_init(rbmpsc_t *ring, void *ring_location,
+                          size_t ring_size);
+
+/**
+ * Reserve a record to be filled in place, any number of producers may call
+ * this concurrently. Records of up to half the ring, less the 8 byte header,
+ * always fit once the consumer caught up.
+ *
+ * @param ring ring context
+ * @param record_len size of the record
+ * @param record set to the reserved memory, to be committed or discarded
+ * @return SUCCESS on success, RINGBUFFER_FULL if there is not enough space
+ */
+int ringbuffer_mpsc_reserve(rbmpsc_t *ring, size_t record_len, void **record);
+
+/**
+ * Hand a filled record over to the consumer.
+ *
+ * @param ring ring context
+ * @param record reserved record
+ */
+void ringbuffer_mpsc_commit(rbmpsc_t *ring, void *record);
+
+/**
+ * Give up a reserved record, the consumer skips it.
+ *
+ * @param ring ring context
+ * @param record reserved record
+ */
+void ringbuffer_mpsc_discard(rbmpsc_t *ring, void *record);
+
+/**
+ * Reserve, fill and commit a record in one go.
+ *
+ * @param ring ring context
+ * @param message message to write
+ * @param message_len size of the message
+ * @return as ringbuffer_mpsc_reserve
+ */
+int ringbuffer_mpsc_write(rbmpsc_t *ring, void *message, size_t message_len);
+
+/**
+ * Read the oldest record, only ever called from one thread at a time.
+ *
+ * @param ring ring context
+ * @param buffer reads to this location
+ * @param buffer_len size of the buffer, set to the size of the record
+ * @return SUCCESS on success, RINGBUFFER_EMPTY if the oldest record is not
+ * committed yet, OUTPUT_BUFFER_TOO_SMALL when it does not fit the buffer (it
+ * stays in place and buffer_len is set to its size)
+ */
+int ringbuffer_mpsc_read(rbmpsc_t *ring, void *buffer, size_t *buffer_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RINGBUF_MPSC_H
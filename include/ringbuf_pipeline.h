@@ -0,0 +1,97 @@
+#ifndef RINGBUF_PIPELINE_H
+#define RINGBUF_PIPELINE_H
+
+#include "ringbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RBUF_PIPELINE_MAX_STAGES 8
+
+/*
+ * A pipeline is a ringbuffer whose messages are processed in place by a fixed
+ * number of ordered stages (e.g. parse -> filter -> persist). Every stage owns
+ * a cursor and may only advance up to the cursor of the stage before it; the
+ * first stage follows the producer. Space is reclaimed once the last stage
+ * released a message. Each stage is meant to be driven by exactly one thread.
+ *
+ * Cursors are monotonically increasing byte sequences, the position in memory
+ * is the sequence modulo the buffer size. Messages never wrap, so a stage
+ * always sees a contiguous payload.
+ */
+typedef struct {
+    uint8_t *begin;
+    size_t size;
+    size_t write;
+    size_t cursor[RBUF_PIPELINE_MAX_STAGES];
+    size_t nr_of_stages;
+    pthread_mutex_t mtx;
+    pthread_cond_t sig;
+} rbpipeline_t;
+
+/**
+ * Initialize a pipeline on top of the given memory.
+ *
+ * @param pipeline pipeline context
+ * @param buffer_location the first byte location of the ringbuffer in memory
+ * @param buffer_size size of the ringbuffer (rounded down to a multiple of 8)
+ * @param nr_of_stages number of stages, 1 to RBUF_PIPELINE_MAX_STAGES
+ */
+void ringbuffer_pipeline_init(rbpipeline_t *pipeline, void *buffer_location,
+                              size_t buffer_size, size_t nr_of_stages);
+
+/**
+ * Write a message into the pipeline, it becomes visible to the first stage.
+ *
+ * @param pipeline pipeline context
+ * @param message The message to be placed in the pipeline
+ * @param message_len size of the message
+ * @return SUCCESS on success, RINGBUFFER_FULL when message doesn't fit
+ */
+int ringbuffer_pipeline_write(rbpipeline_t *pipeline, void *message,
+                              size_t message_len);
+
+/**
+ * Get the next message of a stage without copying it. The message stays
+ * owned by the stage until it is released or discarded, and may be modified
+ * in place for the following stages.
+ *
+ * @param pipeline pipeline context
+ * @param stage index of the calling stage
+ * @param message_ptr set to the first byte of the message in ring memory
+ * @param message_len_ptr set to the size of the message
+ * @return SUCCESS on success, RINGBUFFER_EMPTY if the previous stage has
+ * nothing to hand over
+ */
+int ringbuffer_pipeline_acquire(rbpipeline_t *pipeline, size_t stage,
+                                void **message_ptr, size_t *message_len_ptr);
+
+/**
+ * Hand the message obtained by ringbuffer_pipeline_acquire to the next stage.
+ *
+ * @param pipeline pipeline context
+ * @param stage index of the calling stage
+ */
+void ringbuffer_pipeline_release(rbpipeline_t *pipeline, size_t stage);
+
+/**
+ * Release the acquired message and mark it so that later stages skip it.
+ *
+ * @param pipeline pipeline context
+ * @param stage index of the calling stage
+ */
+void ringbuffer_pipeline_discard(rbpipeline_t *pipeline, size_t stage);
+
+/**
+ * Destroys the syncronization variables of the pipeline.
+ *
+ * @param pipeline pipeline context
+ */
+void ringbuffer_pipeline_destroy(rbpipeline_t *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RINGBUF_PIPELINE_H
@@ -0,0 +1,97 @@
+#ifndef RINGBUF_POOL_H
+#define RINGBUF_POOL_H
+
+#include "ringbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pool of equally sized message buffers, to pass large messages through a
+ * ringbuffer by handle instead of by copy. A producer acquires a buffer, fills
+ * it in place and writes the 8 byte handle into the ring; the consumer reads
+ * the handle, uses the buffer and releases it back to the pool.
+ *
+ * The free buffers form a lock-free LIFO list. Its head packs a generation
+ * tag next to the buffer index, so a CAS cannot succeed on a head that was
+ * popped and pushed again in between (ABA). The link to the next free buffer
+ * is kept in the first bytes of the free buffer itself.
+ */
+typedef struct {
+    uint8_t *begin;
+    size_t buffer_size;
+    uint32_t nr_of_buffers;
+    uint64_t head;  // generation << 32 | (index + 1) of the first free buffer
+} rbpool_t;
+
+/*
+ * What travels through the ring, see ringbuffer_write_handle.
+ */
+typedef struct {
+    uint32_t index;
+    uint32_t length;  // bytes of the buffer in use, set by the producer
+} rbhandle_t;
+
+/**
+ * Initialize a buffer pool on top of the given memory.
+ *
+ * @param pool pool context
+ * @param pool_location the first byte location of the pool in memory
+ * @param pool_size size of the memory, split into as many buffers as fit
+ * @param buffer_size size of every buffer, rounded up to a multiple of 8
+ */
+void ringbuffer_pool_init(rbpool_t *pool, void *pool_location,
+                          size_t pool_size, size_t buffer_size);
+
+/**
+ * Take a free buffer out of the pool.
+ *
+ * @param pool pool context
+ * @param handle set to the buffer, with a length of 0
+ * @return SUCCESS on success, RINGBUFFER_FULL when all buffers are in use
+ */
+int ringbuffer_pool_acquire(rbpool_t *pool, rbhandle_t *handle);
+
+/**
+ * Memory of a buffer, pool->buffer_size bytes.
+ *
+ * @param pool pool context
+ * @param handle acquired buffer
+ * @return the first byte of the buffer
+ */
+void *ringbuffer_pool_data(rbpool_t *pool, rbhandle_t handle);
+
+/**
+ * Give a buffer back to the pool, it must not be used afterwards.
+ *
+ * @param pool pool context
+ * @param handle acquired buffer
+ */
+void ringbuffer_pool_release(rbpool_t *pool, rbhandle_t handle);
+
+/**
+ * Write a buffer handle to a ringbuffer, best one initialized with
+ * ringbuffer_init_slots and a slot size of sizeof(rbhandle_t).
+ *
+ * @param context ringbuffer context
+ * @param handle acquired and filled buffer, owned by the reader afterwards
+ * @return as ringbuffer_write
+ */
+int ringbuffer_write_handle(rbctx_t *context, rbhandle_t handle);
+
+/**
+ * Read a buffer handle from a ringbuffer.
+ *
+ * @param context ringbuffer context
+ * @param handle set to the buffer, to be released by the caller
+ * @return as ringbuffer_read, INVALID_MESSAGE_LENGTH if the message is no
+ * handle
+ */
+int ringbuffer_read_handle(rbctx_t *context, rbhandle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RINGBUF_POOL_H
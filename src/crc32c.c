@@ -0,0 +1,105 @@
+#include "../include/crc32c.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define HAVE_SSE42_BUILTIN 1
+#else
+#define HAVE_SSE42_BUILTIN 0
+#endif
+
+// Reflected Castagnoli polynomial
+#define CRC32C_POLY 0x82F63B78u
+
+uint32_t crc32c_table[256];
+pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+void crc32c_fill_table() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+        }
+        crc32c_table[i] = crc;
+    }
+}
+
+uint32_t crc32c_copy_sw(uint32_t crc, uint8_t *dst, const uint8_t *src,
+                        size_t len) {
+    pthread_once(&crc32c_table_once, crc32c_fill_table);
+    for (size_t i = 0; i < len; i++) {
+        if (dst != NULL) {
+            dst[i] = src[i];
+        }
+        crc = crc32c_table[(crc ^ src[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if HAVE_SSE42_BUILTIN
+/*
+ * Moves 8 bytes per step through a register, feeding the same register to
+ * the crc32 instruction, so the data is only loaded once.
+ */
+__attribute__((target("sse4.2"))) uint32_t crc32c_copy_hw(uint32_t crc,
+                                                          uint8_t *dst,
+                                                          const uint8_t *src,
+                                                          size_t len) {
+    size_t i = 0;
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, 8);
+        if (dst != NULL) {
+            memcpy(dst + i, &word, 8);
+        }
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+#endif
+    for (; i + 4 <= len; i += 4) {
+        uint32_t word;
+        memcpy(&word, src + i, 4);
+        if (dst != NULL) {
+            memcpy(dst + i, &word, 4);
+        }
+        crc = _mm_crc32_u32(crc, word);
+    }
+    for (; i < len; i++) {
+        if (dst != NULL) {
+            dst[i] = src[i];
+        }
+        crc = _mm_crc32_u8(crc, src[i]);
+    }
+    return crc;
+}
+#endif
+
+int crc32c_has_hw() {
+#if HAVE_SSE42_BUILTIN
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return 0;
+#endif
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t len) {
+#if HAVE_SSE42_BUILTIN
+    if (crc32c_has_hw()) {
+        return crc32c_copy_hw(crc, NULL, data, len);
+    }
+#endif
+    return crc32c_copy_sw(crc, NULL, data, len);
+}
+
+uint32_t crc32c_copy(uint32_t crc, void *dst, const void *src, size_t len) {
+#if HAVE_SSE42_BUILTIN
+    if (crc32c_has_hw()) {
+        return crc32c_copy_hw(crc, dst, src, len);
+    }
+#endif
+    return crc32c_copy_sw(crc, dst, src, len);
+}
@@ -1,5 +1,6 @@
 #include "../include/daemon.h"
 
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -83,6 +84,7 @@ void *write_packets(void *arg) {
 
 typedef struct {
     size_t next_packet_id;
+    int closed;  // shutting down, packets still waiting give up
     pthread_mutex_t mutex;
     pthread_cond_t signal;
 } port_value_t;
@@ -116,20 +118,47 @@ int contains_malicious(unsigned char *message, size_t message_len) {
     return 0;
 }
 
-void *read_packets(void *arg) {
-    // This is probably not necessary as these are the defaults,
-    // but it's more verbose this way.
-    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+// Let bursts overflow to disk instead of stalling the writers. The file is
+// unlinked right away, the ringbuffer keeps it open until destroyed. Has to
+// run before the writer threads start.
+void enable_spill(rbctx_t *ctx) {
+    char spill_path[] = "/tmp/daemon_spill_XXXXXX";
+    int spill_fd = mkstemp(spill_path);
+    if (spill_fd < 0) {
+        fprintf(stderr, "Cannot create a spill file, writers may stall\n");
+        return;
+    }
+    close(spill_fd);
+    if (ringbuffer_enable_spill(ctx, spill_path) != SUCCESS) {
+        fprintf(stderr, "Cannot spill to %s, writers may stall\n", spill_path);
+    }
+    unlink(spill_path);
+}
 
+// Make the readers return: they drain the ringbuffer and stop at
+// RINGBUFFER_CLOSED, packets waiting for an id that never comes give up.
+void stop_readers(rbctx_t *ctx) {
+    ringbuffer_close(ctx);
+    for (int i = 0; i <= MAXIMUM_PORT; i++) {
+        pthread_mutex_lock(&port_values[i].mutex);
+        port_values[i].closed = 1;
+        pthread_cond_broadcast(&port_values[i].signal);
+        pthread_mutex_unlock(&port_values[i].mutex);
+    }
+}
+
+void *read_packets(void *arg) {
     rbctx_t *ctx = (rbctx_t *)arg;
 
     unsigned char buffer[MESSAGE_SIZE];
     size_t buffer_len = MESSAGE_SIZE;
     while (1) {
-        pthread_testcancel();
         buffer_len = MESSAGE_SIZE;
-        if (ringbuffer_read(ctx, buffer, &buffer_len) != SUCCESS) {
+        int ret = ringbuffer_read(ctx, buffer, &buffer_len);
+        if (ret == RINGBUFFER_CLOSED) {
+            break;
+        }
+        if (ret != SUCCESS) {
             continue;
         }
 
@@ -158,31 +187,33 @@ void *read_packets(void *arg) {
         memcpy(message, buffer + 3 * n, message_len);
 
         port_value_t *port_value = &port_values[target_port];
+        int dropped = invalid_ports(source_port, target_port) ||
+                      contains_malicious(message, message_len);
 
-        if (invalid_ports(source_port, target_port) ||
-            contains_malicious(message, message_len)) {
-            pthread_mutex_lock(&port_value->mutex);
-            port_value->next_packet_id += 1;
-            pthread_cond_broadcast(&port_value->signal);
-            pthread_mutex_unlock(&port_value->mutex);
-            continue;
-        }
-
+        // Dropped packets take their turn too, skipping ahead of an earlier
+        // packet still in flight would leave it waiting forever
         pthread_mutex_lock(&port_value->mutex);
-        while (packet_id != port_value->next_packet_id) {
+        while (packet_id != port_value->next_packet_id &&
+               !port_value->closed) {
             pthread_cond_wait(&port_value->signal, &port_value->mutex);
         }
+        if (packet_id != port_value->next_packet_id) {
+            pthread_mutex_unlock(&port_value->mutex);
+            break;
+        }
 
-        char file_name[20];
-        sprintf(file_name, "%zu.txt", target_port);
-        FILE *fout = fopen(file_name, "a");
+        if (!dropped) {
+            char file_name[20];
+            sprintf(file_name, "%zu.txt", target_port);
+            FILE *fout = fopen(file_name, "a");
 
-        if (fout == NULL) {
-            exit(1);
-        }
+            if (fout == NULL) {
+                exit(1);
+            }
 
-        fwrite(message, sizeof(unsigned char), message_len, fout);
-        fclose(fout);
+            fwrite(message, sizeof(unsigned char), message_len, fout);
+            fclose(fout);
+        }
         port_value->next_packet_id += 1;
         pthread_cond_broadcast(&port_value->signal);
         pthread_mutex_unlock(&port_value->mutex);
@@ -204,6 +235,8 @@ int simpledaemon(connection_t *connections, int nr_of_connections) {
     }
 
     ringbuffer_init(&rb_ctx, rbuf, rbuf_size);
+    ringbuffer_set_flags(&rb_ctx, RBUF_FLAG_STATS);
+    enable_spill(&rb_ctx);
 
     /****************************************************************
      * WRITER THREADS
@@ -246,7 +279,7 @@ int simpledaemon(connection_t *connections, int nr_of_connections) {
 
     printf("creating reader threads\n");
 
-    for (int i = 0; i < MAXIMUM_PORT; i++) {
+    for (int i = 0; i <= MAXIMUM_PORT; i++) {
         pthread_mutex_init(&port_values[i].mutex, NULL);
         pthread_cond_init(&port_values[i].signal, NULL);
     }
@@ -272,14 +305,12 @@ int simpledaemon(connection_t *connections, int nr_of_connections) {
         "daemon: waiting for 5 seconds before canceling reading threads\nYou "
         "may want to increase this sleep time if the tests keep failing\n");
     sleep(5);
-    for (int i = 0; i < NUMBER_OF_PROCESSING_THREADS; i++) {
-        pthread_cancel(r_threads[i]);
-    }
 
     /* wait for all threads to finish */
     for (int i = 0; i < nr_of_connections; i++) {
         pthread_join(w_threads[i], NULL);
     }
+    stop_readers(&rb_ctx);
 
     /* join all threads */
     for (int i = 0; i < NUMBER_OF_PROCESSING_THREADS; i++) {
@@ -292,11 +323,19 @@ int simpledaemon(connection_t *connections, int nr_of_connections) {
 
     /* YOUR CODE STARTS HERE */
 
-    for (int i = 0; i < MAXIMUM_PORT; i++) {
+    for (int i = 0; i <= MAXIMUM_PORT; i++) {
         pthread_mutex_destroy(&port_values[i].mutex);
         pthread_cond_destroy(&port_values[i].signal);
     }
 
+    rbstats_t stats;
+    ringbuffer_stats(&rb_ctx, &stats);
+    printf("ringbuffer: %" PRIu64 " messages in, %" PRIu64 " out, %" PRIu64
+           " full writes, %" PRIu64 " empty reads, %" PRIu64
+           " spilled, high water %" PRIu64 " of %zu bytes\n",
+           stats.messages_in, stats.messages_out, stats.full, stats.empty,
+           stats.spilled, stats.high_water, rbuf_size);
+
     /* YOUR CODE ENDS HERE */
 
     /********************************************************************/
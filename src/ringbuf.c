@@ -1,25 +1,48 @@
 #include "../include/ringbuf.h"
 
+#include "../include/crc32c.h"
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
-uint8_t *incremented_writer(rbctx_t *context, uint8_t *writer_ptr) {
-    writer_ptr += 1;
-    if (writer_ptr >= context->end) {
-        writer_ptr = context->begin;
-    }
-    return writer_ptr;
-}
+// Flags that change how messages are laid out in the ring
+#define RBUF_FRAMING_FLAGS \
+    (RBUF_FLAG_CHECKSUM | RBUF_FLAG_TIMESTAMP | RBUF_FLAG_EXPIRY)
+#define MAX_HEADER_SIZE \
+    (sizeof(size_t) + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t))
+#define CHECKSUM_OFFSET sizeof(size_t)
+#define HEADER_CHECKSUM_OFFSET (sizeof(size_t) + sizeof(uint32_t))
+
+#define RBUF_FILE_MAGIC 0x32465542474e4952ULL  // "RINGBUF2"
+#define RBUF_FILE_HEADER 4096  // keeps the ring page aligned
 
-uint8_t *incremented_reader(rbctx_t *context, uint8_t *reader_ptr) {
-    reader_ptr += 1;
-    if (reader_ptr >= context->end) {
-        reader_ptr = context->begin;
+/*
+ * First page of a file opened with ringbuffer_open, the ring follows it.
+ * Offsets are relative to the start of the ring.
+ */
+struct rbfile {
+    uint64_t magic;
+    uint64_t size;
+    uint64_t read;
+    uint64_t write;
+    uint64_t flags;  // framing flags the messages were written with
+};
+
+// Move a reader or writer position n bytes forward, n < buffer size
+uint8_t *advanced(rbctx_t *context, uint8_t *ptr, size_t n) {
+    if (n < (size_t)(context->end - ptr)) {
+        return ptr + n;
     }
-    return reader_ptr;
+    return context->begin + (n - (context->end - ptr));
 }
 
 size_t writable_space(rbctx_t *context) {
@@ -39,112 +62,1968 @@ size_t readable_space(rbctx_t *context) {
 struct timespec get_abstime() {
     struct timespec wait_until;
     clock_gettime(CLOCK_REALTIME, &wait_until);
-    wait_until.tv_sec += 1;
+    wait_until.tv_sec += RBUF_TIMEOUT;
     return wait_until;
 }
 
+uint64_t monotonic_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#ifdef RINGBUF_LOCK_PROFILE
+/*
+ * Per thread lock profile, looked up and updated while holding context->mtx.
+ */
+rblockprof_t *lock_profile_of_thread(rbctx_t *context) {
+    pthread_t self = pthread_self();
+    for (size_t i = 0; i < context->lock_profile_len; i++) {
+        if (pthread_equal(context->lock_profile[i].thread, self)) {
+            return &context->lock_profile[i];
+        }
+    }
+
+    if (context->lock_profile_len == context->lock_profile_cap) {
+        size_t cap = context->lock_profile_cap ? 2 * context->lock_profile_cap
+                                               : 8;
+        rblockprof_t *grown =
+            realloc(context->lock_profile, cap * sizeof(rblockprof_t));
+        if (grown == NULL) {
+            return NULL;
+        }
+        context->lock_profile = grown;
+        context->lock_profile_cap = cap;
+    }
+    rblockprof_t *profile = &context->lock_profile[context->lock_profile_len++];
+    memset(profile, 0, sizeof(rblockprof_t));
+    profile->thread = self;
+    return profile;
+}
+
+void lock_profile_report(rbctx_t *context) {
+    if (context->lock_profile_len == 0) {
+        return;
+    }
+    fprintf(stderr, "ringbuffer %p lock profile (ns)\n", (void *)context);
+    fprintf(stderr, "%8s %12s %14s %14s %10s %14s\n", "thread", "locks",
+            "acquire", "held", "waits", "waiting");
+    for (size_t i = 0; i < context->lock_profile_len; i++) {
+        rblockprof_t *profile = &context->lock_profile[i];
+        fprintf(stderr, "%8zu %12lu %14lu %14lu %10lu %14lu\n", i,
+                profile->locks, profile->acquire_ns, profile->hold_ns,
+                profile->waits, profile->wait_ns);
+    }
+    free(context->lock_profile);
+    context->lock_profile = NULL;
+    context->lock_profile_len = 0;
+    context->lock_profile_cap = 0;
+}
+#endif
+
+void lock_context(rbctx_t *context) {
+#ifdef RINGBUF_LOCK_PROFILE
+    uint64_t start = monotonic_ns();
+    pthread_mutex_lock(&context->mtx);
+    context->locked_at = monotonic_ns();
+    rblockprof_t *profile = lock_profile_of_thread(context);
+    if (profile != NULL) {
+        profile->locks++;
+        profile->acquire_ns += context->locked_at - start;
+    }
+#else
+    pthread_mutex_lock(&context->mtx);
+#endif
+}
+
+void unlock_context(rbctx_t *context) {
+#ifdef RINGBUF_LOCK_PROFILE
+    rblockprof_t *profile = lock_profile_of_thread(context);
+    if (profile != NULL) {
+        profile->hold_ns += monotonic_ns() - context->locked_at;
+    }
+#endif
+    pthread_mutex_unlock(&context->mtx);
+}
+
+/*
+ * pthread_cond_timedwait on the context. The lock is released while waiting,
+ * so with RINGBUF_LOCK_PROFILE the wait is not counted as hold time.
+ */
+int timedwait_context(rbctx_t *context, struct timespec *abstime) {
+#ifdef RINGBUF_LOCK_PROFILE
+    uint64_t start = monotonic_ns();
+    rblockprof_t *profile = lock_profile_of_thread(context);
+    if (profile != NULL) {
+        profile->hold_ns += start - context->locked_at;
+    }
+    int ret = pthread_cond_timedwait(&context->sig, &context->mtx, abstime);
+    context->locked_at = monotonic_ns();
+    // The table may have been reallocated by other threads meanwhile
+    profile = lock_profile_of_thread(context);
+    if (profile != NULL) {
+        profile->waits++;
+        profile->wait_ns += context->locked_at - start;
+    }
+    return ret;
+#else
+    return pthread_cond_timedwait(&context->sig, &context->mtx, abstime);
+#endif
+}
+
+/*
+ * Statistics are only ever updated while holding context->mtx, which makes
+ * the context lock the writer side of a seqlock. ringbuffer_stats only reads
+ * and retries while an update is in progress.
+ */
+void stats_begin(rbctx_t *context) {
+    __atomic_store_n(&context->stats_seq, context->stats_seq + 1,
+                     __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void stats_end(rbctx_t *context) {
+    __atomic_store_n(&context->stats_seq, context->stats_seq + 1,
+                     __ATOMIC_RELEASE);
+}
+
+void stats_add(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+size_t stats_bucket(uint64_t usec) {
+    size_t bucket = 0;
+    while (usec > 0 && bucket < RBUF_STATS_BUCKETS - 1) {
+        usec >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void record_write(rbctx_t *context, int result, size_t message_len) {
+    if (!(context->flags & RBUF_FLAG_STATS)) {
+        return;
+    }
+
+    stats_begin(context);
+    if (result == SUCCESS) {
+        stats_add(&context->stats.messages_in, 1);
+        stats_add(&context->stats.bytes_in, message_len);
+        uint64_t used = readable_space(context);
+        if (used > context->stats.high_water) {
+            stats_add(&context->stats.high_water,
+                      used - context->stats.high_water);
+        }
+    } else if (result == RINGBUFFER_FULL) {
+        stats_add(&context->stats.full, 1);
+    }
+    stats_end(context);
+}
+
+void record_read(rbctx_t *context, int result, size_t message_len) {
+    if (!(context->flags & RBUF_FLAG_STATS)) {
+        return;
+    }
+
+    stats_begin(context);
+    if (result == SUCCESS) {
+        stats_add(&context->stats.messages_out, 1);
+        stats_add(&context->stats.bytes_out, message_len);
+    } else if (result == RINGBUFFER_EMPTY) {
+        stats_add(&context->stats.empty, 1);
+    }
+    stats_end(context);
+}
+
+/*
+ * Wait for a signal for at most RBUF_TIMEOUT, with context->mtx held.
+ * The time spent waiting goes into the given blocked time histogram.
+ * Returns right away for RBUF_FLAG_NONBLOCK.
+ *
+ * @return the result of pthread_cond_timedwait
+ */
+int wait_for_signal(rbctx_t *context, uint64_t *histogram) {
+    if (context->flags & RBUF_FLAG_NONBLOCK) {
+        return EWOULDBLOCK;
+    }
+    // Nothing is going to change anymore
+    if (context->closed) {
+        return EPIPE;
+    }
+
+    struct timespec abstime = get_abstime();
+    if (!(context->flags & RBUF_FLAG_STATS)) {
+        return timedwait_context(context, &abstime);
+    }
+
+    uint64_t start = monotonic_ns();
+    int ret = timedwait_context(context, &abstime);
+    uint64_t usec = (monotonic_ns() - start) / 1000;
+    stats_begin(context);
+    stats_add(&histogram[stats_bucket(usec)], 1);
+    if (ret == ETIMEDOUT) {
+        stats_add(&context->stats.timeouts, 1);
+    }
+    stats_end(context);
+    return ret;
+}
+
 void ringbuffer_init(rbctx_t *context, void *buffer_location,
                      size_t buffer_size) {
     context->begin = buffer_location;
     context->read = buffer_location;
     context->write = buffer_location;
     context->end = buffer_location + buffer_size;
+    context->slot_size = 0;
+    context->stream = 0;
+    context->flags = 0;
+    context->stats_seq = 0;
+    memset(&context->stats, 0, sizeof(rbstats_t));
+    memset(&context->codel, 0, sizeof(rbcodel_t));
+    context->readable_fd = -1;
+    context->writable_fd = -1;
+    context->writer_starved = 0;
+    context->file = NULL;
+    context->waiters = NULL;
+    context->spill_fd = -1;
+    context->spill_read = 0;
+    context->spill_write = 0;
+    context->spill_writers = 0;
+    context->spill_reader = 0;
+    context->spill_buffer = NULL;
+    context->large_writer = 0;
+    context->large_reader = 0;
+    context->closed = 0;
+
+#ifdef RINGBUF_LOCK_PROFILE
+    context->lock_profile = NULL;
+    context->lock_profile_len = 0;
+    context->lock_profile_cap = 0;
+#endif
 
     pthread_mutex_init(&context->mtx, NULL);
     pthread_cond_init(&context->sig, NULL);
+    pthread_mutex_init(&context->spill_mtx, NULL);
 }
 
-int ringbuffer_write(rbctx_t *context, void *message, size_t message_len) {
-    // Take into consideration the bytes needed to store the message_len
-    pthread_mutex_lock(&context->mtx);
-    while (writable_space(context) < message_len + sizeof(size_t)) {
-        struct timespec abstime = get_abstime();
-        if (pthread_cond_timedwait(&context->sig,
-                                   &context->mtx, &abstime) != 0) {
-            pthread_mutex_unlock(&context->mtx);
+void ringbuffer_init_slots(rbctx_t *context, void *buffer_location,
+                           size_t buffer_size, size_t slot_size) {
+    assert(slot_size > 0);
+    ringbuffer_init(context, buffer_location,
+                    buffer_size - buffer_size % slot_size);
+    context->slot_size = slot_size;
+}
+
+void ringbuffer_init_stream(rbctx_t *context, void *buffer_location,
+                            size_t buffer_size) {
+    ringbuffer_init(context, buffer_location, buffer_size);
+    context->stream = 1;
+}
+
+int ringbuffer_open(rbctx_t *context, const char *path, size_t buffer_size) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return RINGBUFFER_IO_ERROR;
+    }
+
+    struct stat st;
+    size_t map_size = RBUF_FILE_HEADER + buffer_size;
+    int created = 0;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return RINGBUFFER_IO_ERROR;
+    }
+    if (st.st_size == 0) {
+        if (ftruncate(fd, map_size) != 0) {
+            close(fd);
+            return RINGBUFFER_IO_ERROR;
+        }
+        created = 1;
+    } else if ((size_t)st.st_size != map_size) {
+        close(fd);
+        errno = EINVAL;
+        return RINGBUFFER_IO_ERROR;
+    }
+
+    uint8_t *map =
+        mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return RINGBUFFER_IO_ERROR;
+    }
+
+    struct rbfile *file = (struct rbfile *)map;
+    if (!created && (file->magic != RBUF_FILE_MAGIC ||
+                     file->size != buffer_size || file->read >= buffer_size ||
+                     file->write >= buffer_size)) {
+        munmap(map, map_size);
+        errno = EINVAL;
+        return RINGBUFFER_IO_ERROR;
+    }
+
+    ringbuffer_init(context, map + RBUF_FILE_HEADER, buffer_size);
+    context->file = file;
+    if (created) {
+        file->size = buffer_size;
+        file->read = 0;
+        file->write = 0;
+        file->flags = 0;
+        // A crash before this leaves a file that is rejected on open
+        __atomic_store_n(&file->magic, RBUF_FILE_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        context->read = context->begin + file->read;
+        context->write = context->begin + file->write;
+        context->flags = (int)file->flags;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Publish the positions of a file backed ringbuffer, with context->mtx held.
+ * Called after a message was completely copied in or out, so the file always
+ * describes whole messages.
+ */
+void persist_positions(rbctx_t *context) {
+    if (context->file == NULL) {
+        return;
+    }
+    __atomic_store_n(&context->file->write,
+                     (uint64_t)(context->write - context->begin),
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&context->file->read,
+                     (uint64_t)(context->read - context->begin),
+                     __ATOMIC_RELEASE);
+}
+
+void ringbuffer_set_flags(rbctx_t *context, int flags) {
+    lock_context(context);
+    context->flags = flags;
+    if (context->file != NULL) {
+        context->file->flags = flags & RBUF_FRAMING_FLAGS;
+    }
+    unlock_context(context);
+}
+
+int slot_write(rbctx_t *context, void *message, size_t message_len) {
+    if (message_len != context->slot_size) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+
+    // One slot always stays free to tell a full from an empty ringbuffer
+    while (writable_space(context) < context->slot_size) {
+        if (wait_for_signal(context, context->stats.write_blocked_us) != 0 &&
+            writable_space(context) < context->slot_size) {
             return RINGBUFFER_FULL;
         }
     }
 
-    if (writable_space(context) < message_len + sizeof(size_t)) {
-        pthread_mutex_unlock(&context->mtx);
+    // Slots never wrap, so every record is a single copy
+    memcpy(context->write, message, context->slot_size);
+    context->write += context->slot_size;
+    if (context->write >= context->end) {
+        context->write = context->begin;
+    }
+    return SUCCESS;
+}
+
+int slot_read(rbctx_t *context, void *buffer, size_t *buffer_len) {
+    if (*buffer_len < context->slot_size) {
+        return OUTPUT_BUFFER_TOO_SMALL;
+    }
+
+    if (readable_space(context) < context->slot_size) {
+        return RINGBUFFER_EMPTY;
+    }
+
+    memcpy(buffer, context->read, context->slot_size);
+    *buffer_len = context->slot_size;
+    context->read += context->slot_size;
+    if (context->read >= context->end) {
+        context->read = context->begin;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Message header: [length LE 8][crc LE 4, header crc LE 4, RBUF_FLAG_CHECKSUM]
+ * [enqueue time LE 8, RBUF_FLAG_TIMESTAMP][deadline LE 8, RBUF_FLAG_EXPIRY]
+ *
+ * The crc covers the content, the header crc all other header fields. The
+ * length is checked on its own before it is used to find the next message.
+ */
+size_t header_size(rbctx_t *context) {
+    size_t size = sizeof(size_t);
+    if (context->flags & RBUF_FLAG_CHECKSUM) {
+        size += 2 * sizeof(uint32_t);
+    }
+    if (context->flags & RBUF_FLAG_TIMESTAMP) {
+        size += sizeof(uint64_t);
+    }
+    if (context->flags & RBUF_FLAG_EXPIRY) {
+        size += sizeof(uint64_t);
+    }
+    return size;
+}
+
+size_t expiry_offset(rbctx_t *context) {
+    return header_size(context) - sizeof(uint64_t);
+}
+
+size_t timestamp_offset(rbctx_t *context) {
+    size_t offset = header_size(context) - sizeof(uint64_t);
+    if (context->flags & RBUF_FLAG_EXPIRY) {
+        offset -= sizeof(uint64_t);
+    }
+    return offset;
+}
+
+void put_le(uint8_t *dst, uint64_t value, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (uint8_t)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t get_le(const uint8_t *src, size_t len) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        value |= (uint64_t)src[i] << (8 * i);
+    }
+    return value;
+}
+
+// CRC-32C of all header fields but the header crc itself
+uint32_t header_checksum(rbctx_t *context, const uint8_t *header) {
+    size_t after = HEADER_CHECKSUM_OFFSET + sizeof(uint32_t);
+    uint32_t crc =
+        crc32c_update(crc32c_init(), header, HEADER_CHECKSUM_OFFSET);
+    crc = crc32c_update(crc, header + after, header_size(context) - after);
+    return crc32c_final(crc);
+}
+
+/*
+ * Copy len bytes into the ringbuffer starting at the given position, in at
+ * most two contiguous pieces. When crc is given, the checksum of the bytes is
+ * computed in the same pass.
+ *
+ * @return the position after the last written byte
+ */
+uint8_t *copy_to_ring(rbctx_t *context, uint8_t *position, const void *source,
+                      size_t len, uint32_t *crc) {
+    size_t first = context->end - position;
+    if (first > len) {
+        first = len;
+    }
+    if (crc != NULL) {
+        *crc = crc32c_copy(*crc, position, source, first);
+        *crc = crc32c_copy(*crc, context->begin, (uint8_t *)source + first,
+                           len - first);
+    } else {
+        memcpy(position, source, first);
+        memcpy(context->begin, (uint8_t *)source + first, len - first);
+    }
+
+    return advanced(context, position, len);
+}
+
+/*
+ * Counterpart of copy_to_ring.
+ *
+ * @return the position after the last read byte
+ */
+uint8_t *copy_from_ring(rbctx_t *context, uint8_t *position, void *destination,
+                        size_t len, uint32_t *crc) {
+    size_t first = context->end - position;
+    if (first > len) {
+        first = len;
+    }
+    if (crc != NULL) {
+        *crc = crc32c_copy(*crc, destination, position, first);
+        *crc = crc32c_copy(*crc, (uint8_t *)destination + first,
+                           context->begin, len - first);
+    } else {
+        memcpy(destination, position, first);
+        memcpy((uint8_t *)destination + first, context->begin, len - first);
+    }
+
+    return advanced(context, position, len);
+}
+
+// Append raw bytes, all of them or none, with context->mtx held
+int stream_write(rbctx_t *context, void *bytes, size_t len) {
+    while (writable_space(context) < len) {
+        if (wait_for_signal(context, context->stats.write_blocked_us) != 0) {
+            return RINGBUFFER_FULL;
+        }
+    }
+    context->write = copy_to_ring(context, context->write, bytes, len, NULL);
+    return SUCCESS;
+}
+
+// Take up to *buffer_len of the available bytes, with context->mtx held
+int stream_read(rbctx_t *context, void *buffer, size_t *buffer_len) {
+    size_t available = readable_space(context);
+    if (available == 0) {
+        return RINGBUFFER_EMPTY;
+    }
+    if (*buffer_len > available) {
+        *buffer_len = available;
+    }
+    context->read =
+        copy_from_ring(context, context->read, buffer, *buffer_len, NULL);
+    return SUCCESS;
+}
+
+/*
+ * Write one message made of the given parts, with context->mtx held.
+ */
+int message_writev(rbctx_t *context, const struct iovec *parts,
+                   int nr_of_parts, uint64_t deadline_ns) {
+    size_t message_len = 0;
+    for (int i = 0; i < nr_of_parts; i++) {
+        message_len += parts[i].iov_len;
+    }
+
+    // Take into consideration the bytes needed to store the header
+    size_t needed = message_len + header_size(context);
+    while (writable_space(context) < needed) {
+        if (wait_for_signal(context, context->stats.write_blocked_us) != 0) {
+            return RINGBUFFER_FULL;
+        }
+    }
+
+    if (writable_space(context) < needed) {
         return RINGBUFFER_FULL;
     }
 
+    // Write content of message into rinbuffer behind the header, which
+    // carries the checksums of the content, computed while copying, and of
+    // the header itself
     uint8_t *tmp_writer = context->write;
-    // Write the size of the message into buffer before the actual content
-    for (size_t i = 0; i < sizeof(message_len); i++) {
-        *tmp_writer = (uint8_t)((message_len >> (8 * i)) & 0xFF);
-        tmp_writer = incremented_writer(context, tmp_writer);
+    uint8_t *end_of_message =
+        advanced(context, tmp_writer, header_size(context));
+    uint32_t crc = crc32c_init();
+    int checksum = context->flags & RBUF_FLAG_CHECKSUM;
+    for (int i = 0; i < nr_of_parts; i++) {
+        end_of_message =
+            copy_to_ring(context, end_of_message, parts[i].iov_base,
+                         parts[i].iov_len, checksum ? &crc : NULL);
     }
 
-    // Write content of message into rinbuffer
-    for (size_t i = 0; i < message_len; i++) {
-        *tmp_writer = ((char *)message)[i];
-        tmp_writer = incremented_writer(context, tmp_writer);
+    // Write the size of the message into buffer before the actual content
+    uint8_t header[MAX_HEADER_SIZE];
+    put_le(header, message_len, sizeof(size_t));
+    if (context->flags & RBUF_FLAG_TIMESTAMP) {
+        put_le(header + timestamp_offset(context), monotonic_ns(),
+               sizeof(uint64_t));
+    }
+    if (context->flags & RBUF_FLAG_EXPIRY) {
+        put_le(header + expiry_offset(context), deadline_ns, sizeof(uint64_t));
     }
-    context->write = tmp_writer;
+    if (checksum) {
+        put_le(header + CHECKSUM_OFFSET, crc32c_final(crc), sizeof(uint32_t));
+        put_le(header + HEADER_CHECKSUM_OFFSET,
+               header_checksum(context, header), sizeof(uint32_t));
+    }
+    copy_to_ring(context, tmp_writer, header, header_size(context), NULL);
 
-    pthread_cond_signal(&context->sig);
-    pthread_mutex_unlock(&context->mtx);
+    context->write = end_of_message;
     return SUCCESS;
 }
 
-int ringbuffer_read(rbctx_t *context, void *buffer, size_t *buffer_len) {
-    pthread_mutex_lock(&context->mtx);
-    if (readable_space(context) < sizeof(size_t)) {
-        pthread_mutex_unlock(&context->mtx);
+int message_write(rbctx_t *context, void *message, size_t message_len,
+                  uint64_t deadline_ns) {
+    struct iovec part = {message, message_len};
+    return message_writev(context, &part, 1, deadline_ns);
+}
+
+/*
+ * Time at which CoDel sheds the next message while dropping, following the
+ * control law interval / sqrt(count), computed in 16 bit fixed point.
+ */
+uint64_t codel_control_law(rbcodel_t *codel, uint64_t t) {
+    // Integer square root of count << 32, digit by digit
+    uint64_t rest = (uint64_t)codel->count << 32;
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > rest) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (rest >= root + bit) {
+            rest -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return t + codel->interval_ns * 65536 / root;
+}
+
+/*
+ * CoDel (RFC 8289) decision for a message about to be dequeued. Once
+ * messages stayed longer than the target for a whole interval, one is shed
+ * and the pace of shedding increases with the square root of the number
+ * shed until the sojourn time falls below the target again.
+ */
+int codel_shed(rbctx_t *context, uint64_t enqueued_ns) {
+    rbcodel_t *codel = &context->codel;
+    uint64_t now = monotonic_ns();
+    uint64_t sojourn = now > enqueued_ns ? now - enqueued_ns : 0;
+
+    int ok_to_shed = 0;
+    if (sojourn < codel->target_ns) {
+        codel->first_above_ns = 0;
+    } else if (codel->first_above_ns == 0) {
+        codel->first_above_ns = now + codel->interval_ns;
+    } else if ((int64_t)(now - codel->first_above_ns) >= 0) {
+        ok_to_shed = 1;
+    }
+
+    if (codel->dropping) {
+        if (!ok_to_shed) {
+            codel->dropping = 0;
+        } else if ((int64_t)(now - codel->drop_next_ns) >= 0) {
+            codel->count++;
+            codel->drop_next_ns = codel_control_law(codel, codel->drop_next_ns);
+            return 1;
+        }
+        return 0;
+    }
+    if (!ok_to_shed) {
+        return 0;
+    }
+
+    // Resume near the previous rate if the last episode ended recently. The
+    // next drop of that episode may still be ahead, compare as signed.
+    codel->dropping = 1;
+    uint32_t delta = codel->count - codel->last_count;
+    if (delta > 1 && (int64_t)(now - codel->drop_next_ns) <
+                         (int64_t)(16 * codel->interval_ns)) {
+        codel->count = delta;
+    } else {
+        codel->count = 1;
+    }
+    codel->last_count = codel->count;
+    codel->drop_next_ns = codel_control_law(codel, now);
+    return 1;
+}
+
+void record_shed(rbctx_t *context, uint64_t *counter) {
+    if (context->flags & RBUF_FLAG_STATS) {
+        stats_begin(context);
+        stats_add(counter, 1);
+        stats_end(context);
+    }
+}
+
+/*
+ * Decide whether the message with the given header expired (RBUF_FLAG_EXPIRY),
+ * with context->mtx held. Counts the expired message.
+ *
+ * @return 1 when the message has to be skipped
+ */
+int expired_at_dequeue(rbctx_t *context, const uint8_t *header, uint64_t now) {
+    // Expired messages are skipped by their header alone, a run of them is
+    // reclaimed with the single wakeup of this read
+    if (context->flags & RBUF_FLAG_EXPIRY) {
+        uint64_t deadline_ns =
+            get_le(header + expiry_offset(context), sizeof(uint64_t));
+        if (deadline_ns != 0 && now >= deadline_ns) {
+            record_shed(context, &context->stats.expired);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Let CoDel decide on the message with the given header, with context->mtx
+ * held. Only called for a message that is about to be delivered, every call
+ * advances the CoDel state. Counts the shed message. A message CoDel only
+ * marks is delivered with *marked set.
+ *
+ * @return 1 when the message has to be skipped
+ */
+int codel_at_dequeue(rbctx_t *context, const uint8_t *header, int *marked) {
+    if (!(context->flags & RBUF_FLAG_TIMESTAMP) ||
+        context->codel.target_ns == 0) {
+        return 0;
+    }
+    uint64_t enqueued_ns =
+        get_le(header + timestamp_offset(context), sizeof(uint64_t));
+    if (!codel_shed(context, enqueued_ns)) {
+        return 0;
+    }
+    if (context->codel.mark) {
+        record_shed(context, &context->stats.marked);
+        *marked = 1;
+        return 0;
+    }
+    record_shed(context, &context->stats.dropped);
+    return 1;
+}
+
+/*
+ * Decide whether the message with the given header is shed at dequeue, with
+ * context->mtx held: expired or dropped by CoDel.
+ *
+ * @return 1 when the message has to be skipped
+ */
+int shed_at_dequeue(rbctx_t *context, const uint8_t *header, uint64_t now,
+                    int *marked) {
+    return expired_at_dequeue(context, header, now) ||
+           codel_at_dequeue(context, header, marked);
+}
+
+/*
+ * Read and check the header of the message at context->read without
+ * consuming it, with context->mtx held. Writers always publish whole
+ * messages, so a header that fails its crc or claims more than is readable
+ * means the framing is lost. Nothing behind it can be found anymore, all
+ * readable bytes are dropped.
+ *
+ * @return SUCCESS with *content set to the position after the header,
+ * RINGBUFFER_EMPTY, CHECKSUM_MISMATCH when the ringbuffer was dropped
+ */
+int header_read(rbctx_t *context, uint8_t *header, uint8_t **content) {
+    size_t readable = readable_space(context);
+    if (readable < header_size(context)) {
         return RINGBUFFER_EMPTY;
     }
+    *content = copy_from_ring(context, context->read, header,
+                              header_size(context), NULL);
+    int intact =
+        get_le(header, sizeof(size_t)) <= readable - header_size(context);
+    if (context->flags & RBUF_FLAG_CHECKSUM) {
+        intact = intact && header_checksum(context, header) ==
+                               get_le(header + HEADER_CHECKSUM_OFFSET,
+                                      sizeof(uint32_t));
+    }
+    if (!intact) {
+        context->read = context->write;
+        return CHECKSUM_MISMATCH;
+    }
+    return SUCCESS;
+}
 
-    uint8_t *tmp_reader = context->read;
+int message_read(rbctx_t *context, void *buffer, size_t *buffer_len,
+                 rbmeta_t *meta) {
     // Read the size of the message before reading the actual content
-    size_t message_len = 0;
-    for (size_t i = 0; i < sizeof(size_t); i++) {
-        message_len |= (uint8_t)*tmp_reader << (8 * i);
-        tmp_reader = incremented_reader(context, tmp_reader);
+    uint8_t header[MAX_HEADER_SIZE];
+    uint8_t *tmp_reader;
+    size_t message_len;
+    uint64_t enqueued_ns = 0;
+    int marked = 0;
+    uint64_t now = 0;
+    if (context->flags & RBUF_FLAG_EXPIRY) {
+        now = monotonic_ns();
+    }
+    for (;;) {
+        int ret = header_read(context, header, &tmp_reader);
+        if (ret != SUCCESS) {
+            return ret;
+        }
+        message_len = get_le(header, sizeof(size_t));
+        if (expired_at_dequeue(context, header, now)) {
+            context->read = advanced(context, tmp_reader, message_len);
+            continue;
+        }
+        // The message stays in place for a retry with a larger buffer, CoDel
+        // must not see it before that or it counts the message twice
+        if (message_len > *buffer_len) {
+            return OUTPUT_BUFFER_TOO_SMALL;
+        }
+        if (!codel_at_dequeue(context, header, &marked)) {
+            break;
+        }
+        context->read = advanced(context, tmp_reader, message_len);
+    }
+    if (context->flags & RBUF_FLAG_TIMESTAMP) {
+        enqueued_ns =
+            get_le(header + timestamp_offset(context), sizeof(uint64_t));
     }
 
-    if (message_len > *buffer_len) {
-        context->read = tmp_reader;
-        pthread_mutex_unlock(&context->mtx);
-        return OUTPUT_BUFFER_TOO_SMALL;
+    if (meta != NULL) {
+        meta->enqueued_ns = enqueued_ns;
+        meta->sojourn_ns = enqueued_ns ? monotonic_ns() - enqueued_ns : 0;
+        meta->marked = marked;
     }
+
     *buffer_len = message_len;
 
-    while (readable_space(context) < message_len) {
-        struct timespec abstime = get_abstime();
-        if (pthread_cond_timedwait(&context->sig, &context->mtx,
-                                   &abstime) != 0) {
-            context->read = tmp_reader;
-            pthread_mutex_unlock(&context->mtx);
-            return RINGBUFFER_EMPTY;
+    // Read the actual content of the ringbuffer into the given buffer
+    if (!(context->flags & RBUF_FLAG_CHECKSUM)) {
+        context->read =
+            copy_from_ring(context, tmp_reader, buffer, message_len, NULL);
+        return SUCCESS;
+    }
+
+    uint32_t expected = get_le(header + CHECKSUM_OFFSET, sizeof(uint32_t));
+    uint32_t crc = crc32c_init();
+    context->read =
+        copy_from_ring(context, tmp_reader, buffer, message_len, &crc);
+    if (crc32c_final(crc) != expected) {
+        return CHECKSUM_MISMATCH;
+    }
+    return SUCCESS;
+}
+
+void notify_fd(int fd) {
+    uint64_t one = 1;
+    if (fd >= 0 && write(fd, &one, sizeof(one)) < 0) {
+        // The counter can only overflow if nobody ever reads it
+    }
+}
+
+/*
+ * Notification shared by all rings a ringbuffer_poll call waits on. It lives
+ * on the stack of the poller, every ring links one rbwaiter to it.
+ */
+typedef struct {
+    pthread_mutex_t mtx;
+    pthread_cond_t sig;
+    int notified;
+} rbnotifier_t;
+
+struct rbwaiter {
+    rbnotifier_t *notifier;
+    struct rbwaiter *next;
+};
+
+void notify_waiters(rbctx_t *context) {
+    for (struct rbwaiter *waiter = context->waiters; waiter != NULL;
+         waiter = waiter->next) {
+        rbnotifier_t *notifier = waiter->notifier;
+        pthread_mutex_lock(&notifier->mtx);
+        notifier->notified = 1;
+        pthread_cond_signal(&notifier->sig);
+        pthread_mutex_unlock(&notifier->mtx);
+    }
+}
+
+/*
+ * eventfds and pollers are only notified on transitions, from empty to
+ * non-empty for readers and after a failed write for writers. A consumer
+ * that drains the ring until RINGBUFFER_EMPTY is guaranteed to be notified
+ * again.
+ */
+void notify_readers(rbctx_t *context, int was_empty) {
+    if (was_empty) {
+        notify_fd(context->readable_fd);
+        notify_waiters(context);
+    }
+}
+
+void notify_writers(rbctx_t *context) {
+    if (context->writer_starved) {
+        context->writer_starved = 0;
+        notify_fd(context->writable_fd);
+    }
+}
+
+// Bytes a message of message_len occupies in the ring
+size_t ring_footprint(rbctx_t *context, size_t message_len) {
+    if (context->slot_size != 0) {
+        return context->slot_size;
+    }
+    if (context->stream) {
+        return message_len;
+    }
+    return message_len + header_size(context);
+}
+
+int ringbuffer_enable_spill(rbctx_t *context, const char *path) {
+    // Spilled writes are read back whole, which a byte stream cannot do
+    if (context->stream) {
+        errno = EINVAL;
+        return RINGBUFFER_IO_ERROR;
+    }
+    // Room for all records that can be moved back into the ring at once
+    uint8_t *buffer =
+        malloc((size_t)(context->end - context->begin) + sizeof(size_t));
+    if (buffer == NULL) {
+        return RINGBUFFER_IO_ERROR;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        free(buffer);
+        return RINGBUFFER_IO_ERROR;
+    }
+    lock_context(context);
+    if (context->spill_fd >= 0) {
+        close(context->spill_fd);
+    }
+    free(context->spill_buffer);
+    context->spill_fd = fd;
+    context->spill_buffer = buffer;
+    context->spill_read = 0;
+    context->spill_write = 0;
+    unlock_context(context);
+    return SUCCESS;
+}
+
+int spill_pending(rbctx_t *context) {
+    return context->spill_read < context->spill_write;
+}
+
+// Anything to read, in memory or spilled
+int has_data(rbctx_t *context) {
+    return readable_space(context) != 0 || spill_pending(context);
+}
+
+/*
+ * The spill file is only read and written without context->mtx, so a slow
+ * disk holds up the threads doing the I/O and nobody else. Appends are
+ * serialized by spill_mtx, which is taken before context->mtx. Readers take
+ * turns with spill_reader and only read what was published in spill_write.
+ *
+ * Records use the staging layout [size_t length][message], so a staged batch
+ * of a coalescer or transaction is spilled with a single write.
+ */
+
+/*
+ * Whether messages taking footprint bytes of the ring have to be spilled,
+ * with context->mtx held. Once something is spilled or being spilled, later
+ * messages have to follow it to the file to stay in order.
+ */
+int must_spill(rbctx_t *context, size_t footprint) {
+    return context->spill_fd >= 0 &&
+           (spill_pending(context) || context->spill_writers > 0 ||
+            writable_space(context) < footprint);
+}
+
+/*
+ * Append records to the spill file, with context->mtx held on entry and
+ * return. Writers arriving in the meantime see spill_writers and queue up
+ * behind. Nothing is published unless all records were written.
+ */
+int spill_records(rbctx_t *context, const struct iovec *records,
+                  int nr_of_parts, size_t nr_of_messages) {
+    size_t len = 0;
+    for (int i = 0; i < nr_of_parts; i++) {
+        len += records[i].iov_len;
+    }
+    context->spill_writers++;
+    unlock_context(context);
+
+    pthread_mutex_lock(&context->spill_mtx);
+    ssize_t written = pwritev(context->spill_fd, records, nr_of_parts,
+                              context->spill_write);
+    lock_context(context);
+    context->spill_writers--;
+    int ret = RINGBUFFER_IO_ERROR;
+    if (written == (ssize_t)len) {
+        int was_empty = !has_data(context);
+        context->spill_write += len;
+        notify_readers(context, was_empty);
+        if (context->flags & RBUF_FLAG_STATS) {
+            stats_begin(context);
+            stats_add(&context->stats.spilled, nr_of_messages);
+            stats_end(context);
+        }
+        ret = SUCCESS;
+    }
+    pthread_mutex_unlock(&context->spill_mtx);
+    return ret;
+}
+
+/*
+ * Start the spill file over once it is drained, with context->mtx held on
+ * entry and return. Skipped while an append holds spill_mtx, the file is not
+ * going to stay drained then.
+ */
+void spill_truncate(rbctx_t *context) {
+    if (spill_pending(context) || context->spill_write == 0 ||
+        pthread_mutex_trylock(&context->spill_mtx) != 0) {
+        return;
+    }
+    context->spill_read = 0;
+    context->spill_write = 0;
+    unlock_context(context);
+    if (ftruncate(context->spill_fd, 0) != 0) {
+        // The file keeps its size and is overwritten from the start
+    }
+    pthread_mutex_unlock(&context->spill_mtx);
+    lock_context(context);
+}
+
+// Store a message in the ring itself, with context->mtx held
+int ring_write(rbctx_t *context, void *message, size_t message_len,
+               uint64_t deadline_ns) {
+    if (context->slot_size != 0) {
+        return slot_write(context, message, message_len);
+    }
+    if (context->stream) {
+        return stream_write(context, message, message_len);
+    }
+    return message_write(context, message, message_len, deadline_ns);
+}
+
+/*
+ * Move the oldest spilled messages back into the ring as far as they fit,
+ * with context->mtx held on entry and return. Writers keep appending to the
+ * file until it is drained, so the order is kept, and return to the ring as
+ * soon as it is.
+ */
+void spill_refill(rbctx_t *context) {
+    if (context->spill_reader || !spill_pending(context)) {
+        return;
+    }
+    uint64_t offset = context->spill_read;
+    size_t len = writable_space(context) + sizeof(size_t);
+    if (len > context->spill_write - offset) {
+        len = context->spill_write - offset;
+    }
+    context->spill_reader = 1;
+    unlock_context(context);
+    ssize_t got = pread(context->spill_fd, context->spill_buffer, len, offset);
+    lock_context(context);
+    context->spill_reader = 0;
+    if (got != (ssize_t)len) {
+        return;
+    }
+
+    // Only readers made room meanwhile, what fitted before still fits
+    uint8_t *record = context->spill_buffer;
+    uint8_t *end = record + len;
+    while ((size_t)(end - record) >= sizeof(size_t)) {
+        size_t message_len;
+        memcpy(&message_len, record, sizeof(size_t));
+        if (message_len > (size_t)(end - record) - sizeof(size_t) ||
+            writable_space(context) < ring_footprint(context, message_len)) {
+            break;
         }
+        ring_write(context, record + sizeof(size_t), message_len, 0);
+        record += sizeof(size_t) + message_len;
     }
+    context->spill_read += record - context->spill_buffer;
+    spill_truncate(context);
+}
 
-    if (readable_space(context) < message_len) {
-        context->read = tmp_reader;
-        pthread_mutex_unlock(&context->mtx);
+/*
+ * Read the oldest spilled message straight from the file, with context->mtx
+ * held on entry and return. Only called once the ring is empty, for messages
+ * too large to ever be moved back. A message that does not fit the buffer
+ * stays in place and *buffer_len is set to its size.
+ */
+int spill_read(rbctx_t *context, void *buffer, size_t *buffer_len) {
+    if (context->spill_reader) {
         return RINGBUFFER_EMPTY;
     }
+    uint64_t offset = context->spill_read;
+    context->spill_reader = 1;
+    unlock_context(context);
 
-    // Read the actual content of the ringbuffer into the given buffer
-    for (size_t i = 0; i < message_len; i++) {
-        ((char *)buffer)[i] = *tmp_reader;
-        tmp_reader = incremented_reader(context, tmp_reader);
+    size_t message_len;
+    int ret = SUCCESS;
+    if (pread(context->spill_fd, &message_len, sizeof(size_t), offset) !=
+        sizeof(size_t)) {
+        ret = RINGBUFFER_IO_ERROR;
+    } else if (message_len > *buffer_len) {
+        *buffer_len = message_len;
+        ret = OUTPUT_BUFFER_TOO_SMALL;
+    } else if (pread(context->spill_fd, buffer, message_len,
+                     offset + sizeof(size_t)) != (ssize_t)message_len) {
+        ret = RINGBUFFER_IO_ERROR;
     }
-    context->read = tmp_reader;
 
-    pthread_cond_signal(&context->sig);
-    pthread_mutex_unlock(&context->mtx);
+    lock_context(context);
+    context->spill_reader = 0;
+    if (ret == SUCCESS) {
+        *buffer_len = message_len;
+        context->spill_read += sizeof(size_t) + message_len;
+        spill_truncate(context);
+    }
+    return ret;
+}
+
+// Store a message in the ring or the spill file, with context->mtx held
+int write_locked(rbctx_t *context, void *message, size_t message_len,
+                 uint64_t deadline_ns) {
+    if (context->closed) {
+        return RINGBUFFER_CLOSED;
+    }
+    if (context->slot_size != 0 && message_len != context->slot_size) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+    // Never fits, no point in waiting for readers
+    if (context->spill_fd < 0 &&
+        ring_footprint(context, message_len) >=
+            (size_t)(context->end - context->begin)) {
+        return RINGBUFFER_FULL;
+    }
+    int ret;
+    if (must_spill(context, ring_footprint(context, message_len))) {
+        struct iovec record[2] = {{&message_len, sizeof(size_t)},
+                                  {message, message_len}};
+        ret = spill_records(context, record, 2, 1);
+    } else {
+        ret = ring_write(context, message, message_len, deadline_ns);
+    }
+    // Closed while waiting for room
+    if (ret == RINGBUFFER_FULL && context->closed) {
+        return RINGBUFFER_CLOSED;
+    }
+    return ret;
+}
+
+int ringbuffer_write_ttl(rbctx_t *context, void *message, size_t message_len,
+                         uint64_t ttl_us) {
+    uint64_t deadline_ns = 0;
+    if (ttl_us != 0) {
+        deadline_ns = monotonic_ns() + ttl_us * 1000;
+    }
+
+    lock_context(context);
+    int was_empty = !has_data(context);
+    int ret = write_locked(context, message, message_len, deadline_ns);
+    record_write(context, ret, message_len);
+
+    if (ret == SUCCESS) {
+        persist_positions(context);
+        pthread_cond_signal(&context->sig);
+        notify_readers(context, was_empty);
+    } else if (ret == RINGBUFFER_FULL) {
+        context->writer_starved = 1;
+    }
+    unlock_context(context);
+    return ret;
+}
+
+int ringbuffer_write(rbctx_t *context, void *message, size_t message_len) {
+    return ringbuffer_write_ttl(context, message, message_len, 0);
+}
+
+int ringbuffer_read_meta(rbctx_t *context, void *buffer, size_t *buffer_len,
+                         rbmeta_t *meta) {
+    lock_context(context);
+    uint8_t *read_before = context->read;
+    int ret;
+    if (meta != NULL) {
+        memset(meta, 0, sizeof(rbmeta_t));
+    }
+    if (spill_pending(context)) {
+        spill_refill(context);
+    }
+    if (readable_space(context) == 0 && spill_pending(context)) {
+        ret = spill_read(context, buffer, buffer_len);
+    } else if (context->slot_size != 0) {
+        ret = slot_read(context, buffer, buffer_len);
+    } else if (context->stream) {
+        ret = stream_read(context, buffer, buffer_len);
+    } else {
+        ret = message_read(context, buffer, buffer_len, meta);
+    }
+    // Drained after ringbuffer_close
+    if (ret == RINGBUFFER_EMPTY && context->closed && !has_data(context)) {
+        ret = RINGBUFFER_CLOSED;
+    }
+    record_read(context, ret, *buffer_len);
+    persist_positions(context);
+
+    // Dropped messages free space as well
+    if (ret == SUCCESS || ret == CHECKSUM_MISMATCH ||
+        context->read != read_before) {
+        pthread_cond_signal(&context->sig);
+        notify_writers(context);
+    }
+    unlock_context(context);
+    return ret;
+}
+
+int ringbuffer_read(rbctx_t *context, void *buffer, size_t *buffer_len) {
+    return ringbuffer_read_meta(context, buffer, buffer_len, NULL);
+}
+
+/*
+ * Pass the oldest spilled message to the visitor, with context->mtx held on
+ * entry and return. It is not in ring memory, so it goes through a temporary
+ * copy.
+ */
+int spill_visit(rbctx_t *context, rbvisitor_t visitor, void *user,
+                size_t *message_len, int *stop) {
+    void *message = NULL;
+    *message_len = 0;
+    int ret;
+    while ((ret = spill_read(context, message, message_len)) ==
+           OUTPUT_BUFFER_TOO_SMALL) {
+        free(message);
+        message = malloc(*message_len);
+        if (message == NULL) {
+            return RINGBUFFER_IO_ERROR;
+        }
+    }
+    if (ret == SUCCESS) {
+        *stop = visitor(user, message, *message_len, NULL, 0);
+    }
+    free(message);
+    return ret;
+}
+
+/*
+ * Pass the oldest message to the visitor in place, with context->mtx held.
+ * Messages shed at dequeue are skipped, a corrupted one is dropped with
+ * CHECKSUM_MISMATCH.
+ */
+int message_visit(rbctx_t *context, uint64_t now, rbvisitor_t visitor,
+                  void *user, size_t *message_len, int *stop) {
+    uint8_t header[MAX_HEADER_SIZE];
+    uint8_t *content;
+    int marked = 0;
+    for (;;) {
+        int ret = header_read(context, header, &content);
+        if (ret != SUCCESS) {
+            return ret;
+        }
+        *message_len = get_le(header, sizeof(size_t));
+        if (!shed_at_dequeue(context, header, now, &marked)) {
+            break;
+        }
+        context->read = advanced(context, content, *message_len);
+    }
+
+    size_t first = context->end - content;
+    if (first > *message_len) {
+        first = *message_len;
+    }
+    context->read = advanced(context, content, *message_len);
+
+    if (context->flags & RBUF_FLAG_CHECKSUM) {
+        uint32_t crc = crc32c_update(crc32c_init(), content, first);
+        crc = crc32c_update(crc, context->begin, *message_len - first);
+        if (crc32c_final(crc) !=
+            get_le(header + CHECKSUM_OFFSET, sizeof(uint32_t))) {
+            return CHECKSUM_MISMATCH;
+        }
+    }
+    *stop = visitor(user, content, first, context->begin, *message_len - first);
+    return SUCCESS;
+}
+
+int ringbuffer_consume(rbctx_t *context, size_t max_messages,
+                       rbvisitor_t visitor, void *user) {
+    uint64_t now = 0;
+    if (context->flags & RBUF_FLAG_EXPIRY) {
+        now = monotonic_ns();
+    }
+
+    lock_context(context);
+    if (spill_pending(context)) {
+        spill_refill(context);
+    }
+    uint8_t *read_before = context->read;
+    int released = 0;
+    int consumed = 0;
+    int stop = 0;
+    while ((size_t)consumed < max_messages && !stop) {
+        size_t message_len = 0;
+        int ret;
+        if (readable_space(context) == 0 && spill_pending(context)) {
+            ret = spill_visit(context, visitor, user, &message_len, &stop);
+        } else if (context->slot_size != 0) {
+            ret = RINGBUFFER_EMPTY;
+            if (readable_space(context) >= context->slot_size) {
+                message_len = context->slot_size;
+                uint8_t *slot = context->read;
+                context->read = advanced(context, slot, message_len);
+                stop = visitor(user, slot, message_len, NULL, 0);
+                ret = SUCCESS;
+            }
+        } else if (context->stream) {
+            // Everything available is one visit
+            ret = RINGBUFFER_EMPTY;
+            message_len = readable_space(context);
+            if (message_len != 0) {
+                uint8_t *bytes = context->read;
+                size_t first = context->end - bytes;
+                if (first > message_len) {
+                    first = message_len;
+                }
+                context->read = context->write;
+                stop = visitor(user, bytes, first, context->begin,
+                               message_len - first);
+                ret = SUCCESS;
+            }
+        } else {
+            ret = message_visit(context, now, visitor, user, &message_len,
+                                &stop);
+        }
+        if (ret == CHECKSUM_MISMATCH) {
+            released = 1;
+            continue;
+        }
+        if (ret != SUCCESS) {
+            break;
+        }
+        record_read(context, ret, message_len);
+        released = 1;
+        consumed++;
+    }
+
+    // Everything visited is released with a single wakeup
+    if (released || context->read != read_before) {
+        persist_positions(context);
+        pthread_cond_broadcast(&context->sig);
+        notify_writers(context);
+    }
+    unlock_context(context);
+    return consumed;
+}
+
+/*
+ * Fragmented messages of ringbuffer_write_large: every fragment is a message
+ * of its own whose content starts with the number of bytes of the whole
+ * message following the fragment, 0 for the last one. The top byte of that
+ * prefix is FRAGMENT_MARK, to tell fragments from other messages.
+ */
+#define FRAGMENT_PREFIX_SIZE sizeof(uint64_t)
+#define FRAGMENT_MARK_MASK (0xffULL << 56)
+#define FRAGMENT_MARK (0xf7ULL << 56)
+
+size_t fragment_overhead(rbctx_t *context) {
+    return header_size(context) + FRAGMENT_PREFIX_SIZE;
+}
+
+/*
+ * Take the bytes following a fragment from its prefix.
+ *
+ * @return 1 when the prefix is the one of a fragment, 0 otherwise
+ */
+int fragment_remaining(const uint8_t *prefix, uint64_t *remaining) {
+    uint64_t value = get_le(prefix, FRAGMENT_PREFIX_SIZE);
+    *remaining = value & ~FRAGMENT_MARK_MASK;
+    return (value & FRAGMENT_MARK_MASK) == FRAGMENT_MARK;
+}
+
+// Wait for a signal while a fragmented message is half done, which cannot be
+// given up on, not even with RBUF_FLAG_NONBLOCK. Only ringbuffer_close ends
+// the wait early.
+//
+// @return RINGBUFFER_CLOSED when closed, SUCCESS otherwise
+int wait_mid_message(rbctx_t *context) {
+    if (context->closed) {
+        return RINGBUFFER_CLOSED;
+    }
+    struct timespec abstime = get_abstime();
+    timedwait_context(context, &abstime);
+    return SUCCESS;
+}
+
+int ringbuffer_write_large(rbctx_t *context, void *message,
+                           size_t message_len) {
+    // Fragments cannot be spilled, they would overtake spilled messages
+    if (context->slot_size != 0 || context->stream || context->spill_fd >= 0) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+    size_t capacity = context->end - context->begin - 1;
+    size_t overhead = fragment_overhead(context);
+    if (capacity <= overhead) {
+        return RINGBUFFER_FULL;
+    }
+    // Do not cut the message into tiny fragments while the ring is nearly
+    // full, wait for a reasonable share of it instead
+    size_t min_fragment = (capacity - overhead) / 4 + 1;
+
+    lock_context(context);
+    // Fragments of two messages must not interleave
+    while (context->large_writer || context->closed) {
+        if (wait_for_signal(context, context->stats.write_blocked_us) != 0) {
+            int ret = context->closed ? RINGBUFFER_CLOSED : RINGBUFFER_FULL;
+            record_write(context, ret, message_len);
+            unlock_context(context);
+            return ret;
+        }
+    }
+    context->large_writer = 1;
+
+    uint8_t *position = message;
+    size_t remaining = message_len;
+    int started = 0;
+    int ret = SUCCESS;
+    do {
+        size_t wanted = remaining < min_fragment ? remaining : min_fragment;
+        while (writable_space(context) < overhead + wanted) {
+            if (started) {
+                ret = wait_mid_message(context);
+            } else if (wait_for_signal(context,
+                                       context->stats.write_blocked_us) != 0) {
+                ret = context->closed ? RINGBUFFER_CLOSED : RINGBUFFER_FULL;
+            }
+            if (ret != SUCCESS) {
+                break;
+            }
+        }
+        if (ret == RINGBUFFER_FULL) {
+            context->writer_starved = 1;
+        }
+        if (ret != SUCCESS) {
+            break;
+        }
+
+        size_t fragment_len = writable_space(context) - overhead;
+        if (fragment_len > remaining) {
+            fragment_len = remaining;
+        }
+        remaining -= fragment_len;
+        uint8_t prefix[FRAGMENT_PREFIX_SIZE];
+        put_le(prefix, FRAGMENT_MARK | remaining, FRAGMENT_PREFIX_SIZE);
+        struct iovec parts[2] = {{prefix, FRAGMENT_PREFIX_SIZE},
+                                 {position, fragment_len}};
+        int was_empty = !has_data(context);
+        message_writev(context, parts, 2, 0);
+        position += fragment_len;
+        started = 1;
+
+        persist_positions(context);
+        pthread_cond_broadcast(&context->sig);
+        notify_readers(context, was_empty);
+    } while (remaining > 0);
+
+    context->large_writer = 0;
+    record_write(context, ret, message_len);
+    pthread_cond_broadcast(&context->sig);
+    unlock_context(context);
+    return ret;
+}
+
+/*
+ * Read the fragment at context->read into destination, with context->mtx held
+ * and the fragment readable. A fragment larger than the space left in the
+ * destination can only be corrupted and is dropped. After a corrupted header
+ * nothing is left to read and *remaining is 0.
+ *
+ * @return SUCCESS or CHECKSUM_MISMATCH
+ */
+int fragment_read(rbctx_t *context, uint8_t *destination, size_t space,
+                  uint64_t *remaining, size_t *fragment_len) {
+    uint8_t header[MAX_HEADER_SIZE];
+    uint8_t prefix[FRAGMENT_PREFIX_SIZE];
+    uint32_t crc = crc32c_init();
+    uint32_t *checksum = context->flags & RBUF_FLAG_CHECKSUM ? &crc : NULL;
+    uint8_t *position;
+    if (header_read(context, header, &position) != SUCCESS) {
+        *remaining = 0;
+        *fragment_len = 0;
+        return CHECKSUM_MISMATCH;
+    }
+    size_t message_len = get_le(header, sizeof(size_t));
+    if (message_len < FRAGMENT_PREFIX_SIZE) {
+        context->read = advanced(context, context->read,
+                                 header_size(context) + message_len);
+        *remaining = 0;
+        *fragment_len = 0;
+        return CHECKSUM_MISMATCH;
+    }
+    position = copy_from_ring(context, position, prefix, FRAGMENT_PREFIX_SIZE,
+                              checksum);
+    *fragment_len = message_len - FRAGMENT_PREFIX_SIZE;
+    if (!fragment_remaining(prefix, remaining) || *fragment_len > space) {
+        context->read = advanced(context, context->read,
+                                 header_size(context) + message_len);
+        *remaining = 0;
+        *fragment_len = 0;
+        return CHECKSUM_MISMATCH;
+    }
+
+    context->read = copy_from_ring(context, position, destination,
+                                   *fragment_len, checksum);
+    if (checksum != NULL &&
+        crc32c_final(crc) !=
+            get_le(header + CHECKSUM_OFFSET, sizeof(uint32_t))) {
+        return CHECKSUM_MISMATCH;
+    }
+    return SUCCESS;
+}
+
+int ringbuffer_read_large(rbctx_t *context, void *buffer, size_t *buffer_len) {
+    if (context->slot_size != 0 || context->stream) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+    size_t overhead = fragment_overhead(context);
+
+    lock_context(context);
+    // Another reader is mid-message. After ringbuffer_close it gives up
+    // promptly, keep waiting for it to learn whether anything is left.
+    while (context->large_reader) {
+        int waited = wait_for_signal(context, context->stats.read_blocked_us);
+        if (waited == EPIPE) {
+            struct timespec abstime = get_abstime();
+            timedwait_context(context, &abstime);
+        } else if (waited != 0) {
+            unlock_context(context);
+            return RINGBUFFER_EMPTY;
+        }
+    }
+    if (readable_space(context) < header_size(context)) {
+        int ret = context->closed ? RINGBUFFER_CLOSED : RINGBUFFER_EMPTY;
+        record_read(context, ret, 0);
+        unlock_context(context);
+        return ret;
+    }
+
+    // The first fragment tells the size of the whole message
+    uint8_t header[MAX_HEADER_SIZE];
+    uint8_t prefix[FRAGMENT_PREFIX_SIZE];
+    uint8_t *position;
+    if (header_read(context, header, &position) != SUCCESS) {
+        record_read(context, CHECKSUM_MISMATCH, 0);
+        persist_positions(context);
+        pthread_cond_broadcast(&context->sig);
+        notify_writers(context);
+        unlock_context(context);
+        return CHECKSUM_MISMATCH;
+    }
+    size_t message_len = get_le(header, sizeof(size_t));
+    uint64_t remaining;
+    if (message_len >= FRAGMENT_PREFIX_SIZE) {
+        copy_from_ring(context, position, prefix, FRAGMENT_PREFIX_SIZE, NULL);
+    }
+    // Not written by ringbuffer_write_large, left for ringbuffer_read
+    if (message_len < FRAGMENT_PREFIX_SIZE ||
+        !fragment_remaining(prefix, &remaining)) {
+        unlock_context(context);
+        return INVALID_MESSAGE_LENGTH;
+    }
+    size_t total = message_len - FRAGMENT_PREFIX_SIZE + remaining;
+    if (total > *buffer_len) {
+        *buffer_len = total;
+        unlock_context(context);
+        return OUTPUT_BUFFER_TOO_SMALL;
+    }
+    context->large_reader = 1;
+
+    size_t offset = 0;
+    int ret = SUCCESS;
+    do {
+        while (readable_space(context) < overhead &&
+               wait_mid_message(context) == SUCCESS) {
+        }
+        // Closed before the writer was done, the rest never comes
+        if (readable_space(context) < overhead) {
+            ret = RINGBUFFER_CLOSED;
+            break;
+        }
+        size_t fragment_len;
+        if (fragment_read(context, (uint8_t *)buffer + offset, total - offset,
+                          &remaining, &fragment_len) != SUCCESS) {
+            ret = CHECKSUM_MISMATCH;
+        }
+        offset += fragment_len;
+
+        persist_positions(context);
+        pthread_cond_broadcast(&context->sig);
+        notify_writers(context);
+    } while (remaining > 0);
+
+    context->large_reader = 0;
+    *buffer_len = offset;
+    record_read(context, ret, offset);
+    pthread_cond_broadcast(&context->sig);
+    unlock_context(context);
+    return ret;
+}
+
+void ringbuffer_set_codel(rbctx_t *context, uint64_t target_us,
+                          uint64_t interval_us, int mark) {
+    lock_context(context);
+    memset(&context->codel, 0, sizeof(rbcodel_t));
+    context->codel.target_ns = target_us * 1000;
+    context->codel.interval_ns = interval_us * 1000;
+    context->codel.mark = mark;
+    unlock_context(context);
+}
+
+void ringbuffer_coalesce_init(rbcoalesce_t *coalescer, rbctx_t *context,
+                              void *stage_location, size_t stage_size,
+                              size_t max_messages, uint64_t max_delay_us) {
+    coalescer->ring = context;
+    coalescer->stage = stage_location;
+    coalescer->stage_size = stage_size;
+    coalescer->staged_bytes = 0;
+    coalescer->staged_messages = 0;
+    coalescer->max_messages = max_messages;
+    coalescer->max_delay_us = max_delay_us;
+    coalescer->first_staged_ns = 0;
+}
+
+int ringbuffer_flush(rbcoalesce_t *coalescer) {
+    rbctx_t *context = coalescer->ring;
+    uint8_t *record = coalescer->stage;
+    uint8_t *staged_end = coalescer->stage + coalescer->staged_bytes;
+    int ret = SUCCESS;
+
+    lock_context(context);
+    int was_empty = !has_data(context);
+    size_t published = 0;
+    while (record < staged_end) {
+        size_t message_len;
+        memcpy(&message_len, record, sizeof(size_t));
+        uint8_t *message = record + sizeof(size_t);
+
+        // Readers only learn about the batch when it is published, do not
+        // wait for them to make room without handing over what we have
+        if (published > 0 && context->spill_fd < 0 &&
+            writable_space(context) < ring_footprint(context, message_len)) {
+            persist_positions(context);
+            pthread_cond_broadcast(&context->sig);
+            notify_readers(context, was_empty);
+            was_empty = 0;
+            published = 0;
+        }
+
+        // The rest of the batch follows to the spill file in one go
+        if (!context->closed &&
+            must_spill(context, ring_footprint(context, message_len))) {
+            struct iovec rest = {record, (size_t)(staged_end - record)};
+            ret = spill_records(context, &rest, 1,
+                                coalescer->staged_messages);
+            for (; ret == SUCCESS && record < staged_end;
+                 record += sizeof(size_t) + message_len) {
+                memcpy(&message_len, record, sizeof(size_t));
+                record_write(context, SUCCESS, message_len);
+                coalescer->staged_messages--;
+            }
+            break;
+        }
+
+        ret = write_locked(context, message, message_len, 0);
+        record_write(context, ret, message_len);
+        if (ret != SUCCESS) {
+            break;
+        }
+        record = message + message_len;
+        coalescer->staged_messages--;
+        published++;
+    }
+
+    if (published > 0) {
+        persist_positions(context);
+        pthread_cond_broadcast(&context->sig);
+        notify_readers(context, was_empty);
+    }
+    if (ret == RINGBUFFER_FULL) {
+        context->writer_starved = 1;
+    }
+    unlock_context(context);
+
+    // Keep what did not fit for the next flush
+    coalescer->staged_bytes = staged_end - record;
+    memmove(coalescer->stage, record, coalescer->staged_bytes);
+    return ret;
+}
+
+int ringbuffer_coalesce_poll(rbcoalesce_t *coalescer) {
+    if (coalescer->staged_messages == 0 || coalescer->max_delay_us == 0 ||
+        monotonic_ns() - coalescer->first_staged_ns <
+            coalescer->max_delay_us * 1000) {
+        return SUCCESS;
+    }
+    return ringbuffer_flush(coalescer);
+}
+
+int ringbuffer_coalesce_write(rbcoalesce_t *coalescer, void *message,
+                              size_t message_len) {
+    rbctx_t *context = coalescer->ring;
+    if (context->slot_size != 0 && message_len != context->slot_size) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+    // Would block every later flush, fail it like ringbuffer_write does
+    if (context->spill_fd < 0 &&
+        ring_footprint(context, message_len) >=
+        (size_t)(context->end - context->begin)) {
+        return RINGBUFFER_FULL;
+    }
+
+    size_t record_len = sizeof(size_t) + message_len;
+    if (coalescer->staged_bytes + record_len > coalescer->stage_size) {
+        int ret = ringbuffer_flush(coalescer);
+        if (ret != SUCCESS) {
+            return ret;
+        }
+    }
+    // Too large to be staged at all, keep the order and write it through
+    if (record_len > coalescer->stage_size) {
+        return ringbuffer_write(context, message, message_len);
+    }
+
+    uint8_t *record = coalescer->stage + coalescer->staged_bytes;
+    memcpy(record, &message_len, sizeof(size_t));
+    memcpy(record + sizeof(size_t), message, message_len);
+    coalescer->staged_bytes += record_len;
+    if (coalescer->staged_messages++ == 0) {
+        coalescer->first_staged_ns = monotonic_ns();
+    }
+
+    // The message is accepted, a failed flush only delays it
+    if (coalescer->stage_size - coalescer->staged_bytes <= sizeof(size_t) ||
+        (coalescer->max_messages != 0 &&
+         coalescer->staged_messages >= coalescer->max_messages)) {
+        ringbuffer_flush(coalescer);
+    } else {
+        ringbuffer_coalesce_poll(coalescer);
+    }
     return SUCCESS;
 }
 
+void ringbuffer_txn_begin(rbtxn_t *txn, rbctx_t *context, void *stage_location,
+                          size_t stage_size) {
+    txn->ring = context;
+    txn->stage = stage_location;
+    txn->stage_size = stage_size;
+    ringbuffer_txn_abort(txn);
+}
+
+int ringbuffer_txn_append(rbtxn_t *txn, void *message, size_t message_len) {
+    rbctx_t *context = txn->ring;
+    if (context->slot_size != 0 && message_len != context->slot_size) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+    size_t record_len = sizeof(size_t) + message_len;
+    if (txn->staged_bytes + record_len > txn->stage_size) {
+        return RINGBUFFER_FULL;
+    }
+    // A group larger than the ringbuffer could never be committed
+    size_t footprint = txn->footprint + ring_footprint(context, message_len);
+    if (context->spill_fd < 0 &&
+        footprint >= (size_t)(context->end - context->begin)) {
+        return RINGBUFFER_FULL;
+    }
+
+    uint8_t *record = txn->stage + txn->staged_bytes;
+    memcpy(record, &message_len, sizeof(size_t));
+    memcpy(record + sizeof(size_t), message, message_len);
+    txn->staged_bytes += record_len;
+    txn->staged_messages++;
+    txn->footprint = footprint;
+    return SUCCESS;
+}
+
+int ringbuffer_txn_commit(rbtxn_t *txn) {
+    rbctx_t *context = txn->ring;
+    if (txn->staged_messages == 0) {
+        return SUCCESS;
+    }
+
+    lock_context(context);
+    // Without a spill file the whole group has to fit before the first write
+    while (!context->closed && context->spill_fd < 0 &&
+           writable_space(context) < txn->footprint) {
+        if (wait_for_signal(context, context->stats.write_blocked_us) != 0) {
+            break;
+        }
+    }
+    if (context->closed) {
+        unlock_context(context);
+        return RINGBUFFER_CLOSED;
+    }
+    if (context->spill_fd < 0 && writable_space(context) < txn->footprint) {
+        context->writer_starved = 1;
+        record_write(context, RINGBUFFER_FULL, 0);
+        unlock_context(context);
+        return RINGBUFFER_FULL;
+    }
+
+    int was_empty = !has_data(context);
+    uint8_t *write_before = context->write;
+    uint8_t *record = txn->stage;
+    uint8_t *staged_end = txn->stage + txn->staged_bytes;
+    int ret = SUCCESS;
+    if (must_spill(context, txn->footprint)) {
+        // The stage is laid out like the spill file, published all at once
+        struct iovec group = {txn->stage, txn->staged_bytes};
+        ret = spill_records(context, &group, 1, txn->staged_messages);
+        record = staged_end;
+    }
+    while (record < staged_end && ret == SUCCESS) {
+        size_t message_len;
+        memcpy(&message_len, record, sizeof(size_t));
+        ret = write_locked(context, record + sizeof(size_t), message_len, 0);
+        record += sizeof(size_t) + message_len;
+    }
+
+    if (ret != SUCCESS) {
+        // Readers cannot have seen any of it, take it back
+        context->write = write_before;
+    } else {
+        for (record = txn->stage; record < staged_end;) {
+            size_t message_len;
+            memcpy(&message_len, record, sizeof(size_t));
+            record_write(context, SUCCESS, message_len);
+            record += sizeof(size_t) + message_len;
+        }
+        persist_positions(context);
+        pthread_cond_broadcast(&context->sig);
+        notify_readers(context, was_empty);
+    }
+    unlock_context(context);
+
+    if (ret == SUCCESS) {
+        ringbuffer_txn_abort(txn);
+    }
+    return ret;
+}
+
+void ringbuffer_txn_abort(rbtxn_t *txn) {
+    txn->staged_bytes = 0;
+    txn->staged_messages = 0;
+    txn->footprint = 0;
+}
+
+void ringbuffer_close(rbctx_t *context) {
+    lock_context(context);
+    context->closed = 1;
+    pthread_cond_broadcast(&context->sig);
+    // Unconditionally, event loops have to learn about it either way
+    notify_fd(context->readable_fd);
+    notify_fd(context->writable_fd);
+    notify_waiters(context);
+    unlock_context(context);
+}
+
+int ringbuffer_readable_fd(rbctx_t *context) {
+    lock_context(context);
+    if (context->readable_fd < 0) {
+        context->readable_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        notify_readers(context, has_data(context));
+    }
+    int fd = context->readable_fd;
+    unlock_context(context);
+    return fd;
+}
+
+int ringbuffer_writable_fd(rbctx_t *context) {
+    lock_context(context);
+    if (context->writable_fd < 0) {
+        context->writable_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    int fd = context->writable_fd;
+    unlock_context(context);
+    return fd;
+}
+
+// Readiness of every ring, with or without registering a waiter on it
+int poll_rings(rbctx_t **rings, size_t nr_of_rings, int *ready,
+               struct rbwaiter *waiters) {
+    int nr_ready = 0;
+    for (size_t i = 0; i < nr_of_rings; i++) {
+        lock_context(rings[i]);
+        ready[i] = has_data(rings[i]) || rings[i]->closed;
+        nr_ready += ready[i];
+        if (waiters != NULL) {
+            waiters[i].next = rings[i]->waiters;
+            rings[i]->waiters = &waiters[i];
+        }
+        unlock_context(rings[i]);
+    }
+    return nr_ready;
+}
+
+void unregister_waiters(rbctx_t **rings, size_t nr_of_rings,
+                        struct rbwaiter *waiters) {
+    for (size_t i = 0; i < nr_of_rings; i++) {
+        lock_context(rings[i]);
+        struct rbwaiter **link = &rings[i]->waiters;
+        while (*link != &waiters[i]) {
+            link = &(*link)->next;
+        }
+        *link = waiters[i].next;
+        unlock_context(rings[i]);
+    }
+}
+
+int ringbuffer_poll(rbctx_t **rings, size_t nr_of_rings, int timeout_ms,
+                    int *ready) {
+    int nr_ready = poll_rings(rings, nr_of_rings, ready, NULL);
+    if (nr_ready > 0 || timeout_ms == 0) {
+        return nr_ready;
+    }
+
+    struct timespec abstime;
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec += timeout_ms / 1000;
+    abstime.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (abstime.tv_nsec >= 1000000000) {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000;
+    }
+
+    struct rbwaiter *waiters = malloc(nr_of_rings * sizeof(struct rbwaiter));
+    if (waiters == NULL) {
+        return -1;
+    }
+    rbnotifier_t notifier;
+    pthread_mutex_init(&notifier.mtx, NULL);
+    pthread_cond_init(&notifier.sig, NULL);
+    notifier.notified = 0;
+    for (size_t i = 0; i < nr_of_rings; i++) {
+        waiters[i].notifier = &notifier;
+    }
+
+    // Registered before the check, a write in between notifies us
+    nr_ready = poll_rings(rings, nr_of_rings, ready, waiters);
+    pthread_mutex_lock(&notifier.mtx);
+    while (nr_ready == 0 && !notifier.notified) {
+        int ret;
+        if (timeout_ms < 0) {
+            ret = pthread_cond_wait(&notifier.sig, &notifier.mtx);
+        } else {
+            ret = pthread_cond_timedwait(&notifier.sig, &notifier.mtx,
+                                         &abstime);
+        }
+        if (ret == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&notifier.mtx);
+    unregister_waiters(rings, nr_of_rings, waiters);
+
+    // Notifiers hold the ring lock, none is left after unregistering
+    pthread_mutex_destroy(&notifier.mtx);
+    pthread_cond_destroy(&notifier.sig);
+    free(waiters);
+    return poll_rings(rings, nr_of_rings, ready, NULL);
+}
+
+void ringbuffer_stats(rbctx_t *context, rbstats_t *stats) {
+    const uint64_t *src = (const uint64_t *)&context->stats;
+    uint64_t *dst = (uint64_t *)stats;
+    unsigned seq_before, seq_after;
+    do {
+        seq_before = __atomic_load_n(&context->stats_seq, __ATOMIC_ACQUIRE);
+        for (size_t i = 0; i < sizeof(rbstats_t) / sizeof(uint64_t); i++) {
+            dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq_after = __atomic_load_n(&context->stats_seq, __ATOMIC_RELAXED);
+    } while ((seq_before & 1) || seq_before != seq_after);
+}
+
 void ringbuffer_destroy(rbctx_t *context) {
     if (context == NULL) {
         return;
     }
 
+#ifdef RINGBUF_LOCK_PROFILE
+    lock_profile_report(context);
+#endif
+    if (context->readable_fd >= 0) {
+        close(context->readable_fd);
+    }
+    if (context->writable_fd >= 0) {
+        close(context->writable_fd);
+    }
+    if (context->spill_fd >= 0) {
+        close(context->spill_fd);
+    }
+    free(context->spill_buffer);
+    context->spill_buffer = NULL;
+    if (context->file != NULL) {
+        munmap(context->file,
+               RBUF_FILE_HEADER + (size_t)(context->end - context->begin));
+        context->file = NULL;
+    }
     pthread_mutex_destroy(&context->mtx);
     pthread_cond_destroy(&context->sig);
+    pthread_mutex_destroy(&context->spill_mtx);
 }
@@ -0,0 +1,130 @@
+#include "../include/ringbuf_mpsc.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define MPSC_HEADER_SIZE sizeof(uint64_t)
+#define MPSC_BUSY (1ull << 63)     // reserved, being filled
+#define MPSC_VALID (1ull << 62)    // committed
+#define MPSC_DISCARD (1ull << 61)  // committed, to be skipped
+#define MPSC_LENGTH(header) ((header) & UINT32_MAX)
+
+// Header, payload and padding to the next header
+uint64_t mpsc_record_size(uint64_t record_len) {
+    return (MPSC_HEADER_SIZE + record_len + 7) & ~(uint64_t)7;
+}
+
+uint64_t *mpsc_header(rbmpsc_t *ring, uint64_t position) {
+    return (uint64_t *)(ring->begin + (position & ring->mask));
+}
+
+void ringbuffer_mpsc_init(rbmpsc_t *ring, void *ring_location,
+                          size_t ring_size) {
+    size_t size = 16;
+    while (size * 2 <= ring_size) {
+        size *= 2;
+    }
+    ring->begin = ring_location;
+    ring->mask = size - 1;
+    ring->producer_pos = 0;
+    ring->consumer_pos = 0;
+    memset(ring_location, 0, size);
+}
+
+int ringbuffer_mpsc_reserve(rbmpsc_t *ring, size_t record_len, void **record) {
+    uint64_t size = ring->mask + 1;
+    uint64_t record_size = mpsc_record_size(record_len);
+    if (record_len > UINT32_MAX || record_size > size) {
+        return RINGBUFFER_FULL;
+    }
+
+    uint64_t position = __atomic_load_n(&ring->producer_pos, __ATOMIC_RELAXED);
+    uint64_t padding;
+    do {
+        // Skip to the start of the memory instead of wrapping the record
+        uint64_t to_end = size - (position & ring->mask);
+        padding = record_size > to_end ? to_end : 0;
+        // Pairs with the consumer publishing its position after zeroing, so
+        // the zeroes are in place before we write here
+        uint64_t consumed =
+            __atomic_load_n(&ring->consumer_pos, __ATOMIC_ACQUIRE);
+        if (position + padding + record_size - consumed > size) {
+            return RINGBUFFER_FULL;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->producer_pos, &position,
+                                          position + padding + record_size,
+                                          1, __ATOMIC_ACQUIRE,
+                                          __ATOMIC_RELAXED));
+
+    if (padding != 0) {
+        __atomic_store_n(mpsc_header(ring, position),
+                         (padding - MPSC_HEADER_SIZE) | MPSC_VALID |
+                             MPSC_DISCARD,
+                         __ATOMIC_RELEASE);
+        position += padding;
+    }
+    uint64_t *header = mpsc_header(ring, position);
+    __atomic_store_n(header, record_len | MPSC_BUSY, __ATOMIC_RELAXED);
+    *record = header + 1;
+    return SUCCESS;
+}
+
+// Clear the busy bit, publishing the content written to the record
+void mpsc_complete(void *record, uint64_t flags) {
+    uint64_t *header = (uint64_t *)record - 1;
+    uint64_t record_len =
+        MPSC_LENGTH(__atomic_load_n(header, __ATOMIC_RELAXED));
+    __atomic_store_n(header, record_len | flags, __ATOMIC_RELEASE);
+}
+
+void ringbuffer_mpsc_commit(rbmpsc_t *ring, void *record) {
+    (void)ring;
+    mpsc_complete(record, MPSC_VALID);
+}
+
+void ringbuffer_mpsc_discard(rbmpsc_t *ring, void *record) {
+    (void)ring;
+    mpsc_complete(record, MPSC_VALID | MPSC_DISCARD);
+}
+
+int ringbuffer_mpsc_write(rbmpsc_t *ring, void *message, size_t message_len) {
+    void *record;
+    int ret = ringbuffer_mpsc_reserve(ring, message_len, &record);
+    if (ret != SUCCESS) {
+        return ret;
+    }
+    memcpy(record, message, message_len);
+    ringbuffer_mpsc_commit(ring, record);
+    return SUCCESS;
+}
+
+int ringbuffer_mpsc_read(rbmpsc_t *ring, void *buffer, size_t *buffer_len) {
+    uint64_t position = ring->consumer_pos;  // only written by us
+    for (;;) {
+        uint64_t *header = mpsc_header(ring, position);
+        // 0 while only reserved, busy while being filled
+        uint64_t value = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+        if (!(value & MPSC_VALID)) {
+            return RINGBUFFER_EMPTY;
+        }
+        uint64_t record_len = MPSC_LENGTH(value);
+        if (!(value & MPSC_DISCARD)) {
+            if (record_len > *buffer_len) {
+                *buffer_len = record_len;
+                return OUTPUT_BUFFER_TOO_SMALL;
+            }
+            memcpy(buffer, header + 1, record_len);
+            *buffer_len = record_len;
+        }
+
+        // Leave zeroes behind for the headers of later records, then free
+        // the space
+        uint64_t record_size = mpsc_record_size(record_len);
+        memset(header, 0, record_size);
+        position += record_size;
+        __atomic_store_n(&ring->consumer_pos, position, __ATOMIC_RELEASE);
+        if (!(value & MPSC_DISCARD)) {
+            return SUCCESS;
+        }
+    }
+}
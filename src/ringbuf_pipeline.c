@@ -0,0 +1,170 @@
+#include "../include/ringbuf_pipeline.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Header value of the padding that fills the end of the buffer when the next
+// message would not fit contiguously.
+#define PIPELINE_WRAP SIZE_MAX
+// Set in the header of messages a stage discarded.
+#define PIPELINE_DISCARDED ((size_t)1 << (8 * sizeof(size_t) - 1))
+
+size_t pipeline_footprint(size_t message_len) {
+    // Keep every header 8 byte aligned relative to the buffer start
+    return sizeof(size_t) + ((message_len + 7) & ~(size_t)7);
+}
+
+size_t pipeline_header(rbpipeline_t *pipeline, size_t sequence) {
+    size_t header;
+    memcpy(&header, pipeline->begin + sequence % pipeline->size,
+           sizeof(size_t));
+    return header;
+}
+
+void pipeline_set_header(rbpipeline_t *pipeline, size_t sequence,
+                         size_t header) {
+    memcpy(pipeline->begin + sequence % pipeline->size, &header,
+           sizeof(size_t));
+}
+
+size_t pipeline_barrier(rbpipeline_t *pipeline, size_t stage) {
+    if (stage == 0) {
+        return pipeline->write;
+    }
+    return pipeline->cursor[stage - 1];
+}
+
+size_t pipeline_free_space(rbpipeline_t *pipeline) {
+    size_t last = pipeline->cursor[pipeline->nr_of_stages - 1];
+    return pipeline->size - (pipeline->write - last);
+}
+
+// Waits until `needed` bytes are free, returns 0 on timeout.
+int pipeline_wait_for_space(rbpipeline_t *pipeline, size_t needed) {
+    while (pipeline_free_space(pipeline) < needed) {
+        struct timespec abstime = get_abstime();
+        if (pthread_cond_timedwait(&pipeline->sig, &pipeline->mtx,
+                                   &abstime) != 0) {
+            return pipeline_free_space(pipeline) >= needed;
+        }
+    }
+    return 1;
+}
+
+void ringbuffer_pipeline_init(rbpipeline_t *pipeline, void *buffer_location,
+                              size_t buffer_size, size_t nr_of_stages) {
+    assert(nr_of_stages > 0 && nr_of_stages <= RBUF_PIPELINE_MAX_STAGES);
+
+    pipeline->begin = buffer_location;
+    pipeline->size = buffer_size & ~(size_t)7;
+    pipeline->write = 0;
+    for (size_t i = 0; i < RBUF_PIPELINE_MAX_STAGES; i++) {
+        pipeline->cursor[i] = 0;
+    }
+    pipeline->nr_of_stages = nr_of_stages;
+
+    pthread_mutex_init(&pipeline->mtx, NULL);
+    pthread_cond_init(&pipeline->sig, NULL);
+}
+
+int ringbuffer_pipeline_write(rbpipeline_t *pipeline, void *message,
+                              size_t message_len) {
+    size_t footprint = pipeline_footprint(message_len);
+    if (footprint > pipeline->size) {
+        return RINGBUFFER_FULL;
+    }
+
+    pthread_mutex_lock(&pipeline->mtx);
+    size_t contiguous = pipeline->size - pipeline->write % pipeline->size;
+    if (contiguous < footprint) {
+        // Pad the end of the buffer so the message starts at the beginning
+        if (!pipeline_wait_for_space(pipeline, contiguous)) {
+            pthread_mutex_unlock(&pipeline->mtx);
+            return RINGBUFFER_FULL;
+        }
+        pipeline_set_header(pipeline, pipeline->write, PIPELINE_WRAP);
+        pipeline->write += contiguous;
+        pthread_cond_broadcast(&pipeline->sig);
+    }
+
+    if (!pipeline_wait_for_space(pipeline, footprint)) {
+        pthread_mutex_unlock(&pipeline->mtx);
+        return RINGBUFFER_FULL;
+    }
+
+    pipeline_set_header(pipeline, pipeline->write, message_len);
+    memcpy(pipeline->begin + pipeline->write % pipeline->size + sizeof(size_t),
+           message, message_len);
+    pipeline->write += footprint;
+
+    // All stages share the condition variable, so wake every one of them
+    pthread_cond_broadcast(&pipeline->sig);
+    pthread_mutex_unlock(&pipeline->mtx);
+    return SUCCESS;
+}
+
+int ringbuffer_pipeline_acquire(rbpipeline_t *pipeline, size_t stage,
+                                void **message_ptr, size_t *message_len_ptr) {
+    assert(stage < pipeline->nr_of_stages);
+
+    pthread_mutex_lock(&pipeline->mtx);
+    while (1) {
+        size_t *cursor = &pipeline->cursor[stage];
+        if (*cursor == pipeline_barrier(pipeline, stage)) {
+            struct timespec abstime = get_abstime();
+            if (pthread_cond_timedwait(&pipeline->sig, &pipeline->mtx,
+                                       &abstime) != 0 &&
+                *cursor == pipeline_barrier(pipeline, stage)) {
+                pthread_mutex_unlock(&pipeline->mtx);
+                return RINGBUFFER_EMPTY;
+            }
+            continue;
+        }
+
+        size_t header = pipeline_header(pipeline, *cursor);
+        if (header == PIPELINE_WRAP) {
+            *cursor += pipeline->size - *cursor % pipeline->size;
+            pthread_cond_broadcast(&pipeline->sig);
+            continue;
+        }
+        if (header & PIPELINE_DISCARDED) {
+            *cursor += pipeline_footprint(header & ~PIPELINE_DISCARDED);
+            pthread_cond_broadcast(&pipeline->sig);
+            continue;
+        }
+
+        *message_ptr =
+            pipeline->begin + *cursor % pipeline->size + sizeof(size_t);
+        *message_len_ptr = header;
+        pthread_mutex_unlock(&pipeline->mtx);
+        return SUCCESS;
+    }
+}
+
+void ringbuffer_pipeline_release(rbpipeline_t *pipeline, size_t stage) {
+    pthread_mutex_lock(&pipeline->mtx);
+    size_t header = pipeline_header(pipeline, pipeline->cursor[stage]);
+    pipeline->cursor[stage] += pipeline_footprint(header);
+    pthread_cond_broadcast(&pipeline->sig);
+    pthread_mutex_unlock(&pipeline->mtx);
+}
+
+void ringbuffer_pipeline_discard(rbpipeline_t *pipeline, size_t stage) {
+    pthread_mutex_lock(&pipeline->mtx);
+    size_t header = pipeline_header(pipeline, pipeline->cursor[stage]);
+    pipeline_set_header(pipeline, pipeline->cursor[stage],
+                        header | PIPELINE_DISCARDED);
+    pipeline->cursor[stage] += pipeline_footprint(header);
+    pthread_cond_broadcast(&pipeline->sig);
+    pthread_mutex_unlock(&pipeline->mtx);
+}
+
+void ringbuffer_pipeline_destroy(rbpipeline_t *pipeline) {
+    if (pipeline == NULL) {
+        return;
+    }
+
+    pthread_mutex_destroy(&pipeline->mtx);
+    pthread_cond_destroy(&pipeline->sig);
+}
@@ -0,0 +1,80 @@
+#include "../include/ringbuf_pool.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define POOL_TOP(head) ((uint32_t)(head))
+#define POOL_GENERATION(head) ((head) >> 32)
+
+// Link to the next free buffer, as index + 1 (0 ends the list)
+uint32_t *pool_link(rbpool_t *pool, uint32_t index) {
+    return (uint32_t *)(pool->begin + (size_t)index * pool->buffer_size);
+}
+
+void ringbuffer_pool_init(rbpool_t *pool, void *pool_location,
+                          size_t pool_size, size_t buffer_size) {
+    if (buffer_size < sizeof(uint32_t)) {
+        buffer_size = sizeof(uint32_t);
+    }
+    pool->begin = pool_location;
+    pool->buffer_size = (buffer_size + 7) & ~(size_t)7;
+    size_t nr_of_buffers = pool_size / pool->buffer_size;
+    pool->nr_of_buffers =
+        nr_of_buffers < UINT32_MAX ? (uint32_t)nr_of_buffers : UINT32_MAX - 1;
+
+    for (uint32_t i = 0; i < pool->nr_of_buffers; i++) {
+        *pool_link(pool, i) = i + 1 < pool->nr_of_buffers ? i + 2 : 0;
+    }
+    pool->head = pool->nr_of_buffers > 0 ? 1 : 0;
+}
+
+int ringbuffer_pool_acquire(rbpool_t *pool, rbhandle_t *handle) {
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    do {
+        uint32_t top = POOL_TOP(head);
+        if (top == 0) {
+            return RINGBUFFER_FULL;
+        }
+        // May read a buffer another thread just took and scribbles on, the
+        // generation then makes the CAS fail and the value is thrown away
+        uint32_t next = __atomic_load_n(pool_link(pool, top - 1),
+                                        __ATOMIC_RELAXED);
+        new_head = (POOL_GENERATION(head) + 1) << 32 | next;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, new_head, 1,
+                                          __ATOMIC_ACQUIRE,
+                                          __ATOMIC_ACQUIRE));
+
+    handle->index = POOL_TOP(head) - 1;
+    handle->length = 0;
+    return SUCCESS;
+}
+
+void *ringbuffer_pool_data(rbpool_t *pool, rbhandle_t handle) {
+    return pool->begin + (size_t)handle.index * pool->buffer_size;
+}
+
+void ringbuffer_pool_release(rbpool_t *pool, rbhandle_t handle) {
+    uint32_t *link = pool_link(pool, handle.index);
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+    uint64_t new_head;
+    do {
+        __atomic_store_n(link, POOL_TOP(head), __ATOMIC_RELAXED);
+        new_head = (POOL_GENERATION(head) + 1) << 32 | (handle.index + 1);
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, new_head, 1,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+int ringbuffer_write_handle(rbctx_t *context, rbhandle_t handle) {
+    return ringbuffer_write(context, &handle, sizeof(rbhandle_t));
+}
+
+int ringbuffer_read_handle(rbctx_t *context, rbhandle_t *handle) {
+    size_t handle_len = sizeof(rbhandle_t);
+    int ret = ringbuffer_read(context, handle, &handle_len);
+    if (ret == SUCCESS && handle_len != sizeof(rbhandle_t)) {
+        return INVALID_MESSAGE_LENGTH;
+    }
+    return ret;
+}
@@ -0,0 +1,226 @@
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/ringbuf_coro.hpp"
+
+#define CAPACITY 8
+#define NUMBER_OF_CONSUMERS 1000
+#define MESSAGES_PER_CONSUMER 10
+#define NUMBER_OF_THREADS 2
+
+/*
+ * Fire and forget coroutine, runs until its first suspension on creation and
+ * frees itself when done.
+ */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/*
+ * Scheduler that queues woken coroutines for a pool of worker threads.
+ */
+class RunQueue : public rb::Scheduler {
+   public:
+    void schedule(std::coroutine_handle<> handle) override {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            queue_.push_back(handle);
+        }
+        sig_.notify_one();
+    }
+
+    // Resume queued coroutines until stop() was called and the queue is empty
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        for (;;) {
+            sig_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            std::coroutine_handle<> handle = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+        }
+    }
+
+    // Resume queued coroutines on the calling thread, returns how many ran
+    int drain() {
+        int resumed = 0;
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!queue_.empty()) {
+            std::coroutine_handle<> handle = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            handle.resume();
+            resumed++;
+            lock.lock();
+        }
+        return resumed;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopped_ = true;
+        }
+        sig_.notify_all();
+    }
+
+   private:
+    std::mutex mtx_;
+    std::condition_variable sig_;
+    std::deque<std::coroutine_handle<>> queue_;
+    bool stopped_ = false;
+};
+
+Detached pop_into(rb::CoRing<std::string, CAPACITY> &ring, std::string &out) {
+    out = co_await ring.pop();
+}
+
+Detached push_all(rb::CoRing<int, CAPACITY> &ring, int count, int &done) {
+    for (int i = 0; i < count; i++) {
+        co_await ring.push(i);
+        done = i + 1;
+    }
+}
+
+Detached consume(rb::CoRing<int, CAPACITY> &ring, std::atomic<long> &sum,
+                 std::atomic<int> &finished) {
+    for (int i = 0; i < MESSAGES_PER_CONSUMER; i++) {
+        sum += co_await ring.pop();
+    }
+    finished++;
+}
+
+Detached produce(rb::CoRing<int, CAPACITY> &ring, int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        co_await ring.push(i);
+    }
+}
+
+int main() {
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Popping from an empty ring suspends until a push                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Pop suspends on an empty ring\n");
+    {
+        RunQueue scheduler;
+        rb::CoRing<std::string, CAPACITY> ring(scheduler);
+        std::string first, second;
+        pop_into(ring, first);
+        pop_into(ring, second);
+        if (!first.empty() || scheduler.drain() != 0) {
+            printf("Error: Test 1.1 failed. Pop did not suspend\n");
+            exit(1);
+        }
+        Detached pusher = [](rb::CoRing<std::string, CAPACITY> &ring) -> Detached {
+            co_await ring.push("Hello");
+            co_await ring.push("World");
+        }(ring);
+        (void)pusher;
+        if (scheduler.drain() != 2) {
+            printf("Error: Test 1.2 failed. Poppers were not scheduled\n");
+            exit(1);
+        }
+        if (first != "Hello" || second != "World" || ring.size() != 0) {
+            printf("Error: Test 1.3 failed. Got \"%s\" and \"%s\"\n", first.c_str(), second.c_str());
+            exit(1);
+        }
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Pushing to a full ring suspends until a pop, order is kept            *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Push suspends on a full ring\n");
+    {
+        RunQueue scheduler;
+        rb::CoRing<int, CAPACITY> ring(scheduler);
+        int done = 0;
+        push_all(ring, CAPACITY + 2, done);
+        if (done != CAPACITY || ring.size() != CAPACITY) {
+            printf("Error: Test 2.1 failed. Expected %d pushes, got %d\n", CAPACITY, done);
+            exit(1);
+        }
+        int expected = 0;
+        Detached popper = [](rb::CoRing<int, CAPACITY> &ring, int &expected) -> Detached {
+            for (int i = 0; i < CAPACITY + 2; i++) {
+                if (co_await ring.pop() != expected++) {
+                    printf("Error: Test 2.2 failed. Wrong order at %d\n", i);
+                    exit(1);
+                }
+            }
+        }(ring, expected);
+        (void)popper;
+        while (scheduler.drain() != 0) {
+        }
+        if (done != CAPACITY + 2 || expected != CAPACITY + 2) {
+            printf("Error: Test 2.3 failed. Pushed %d, popped %d\n", done, expected);
+            exit(1);
+        }
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Many coroutines share a few threads                                   *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: %d consumers on %d threads\n", NUMBER_OF_CONSUMERS, NUMBER_OF_THREADS);
+    {
+        RunQueue scheduler;
+        rb::CoRing<int, CAPACITY> ring(scheduler);
+        std::atomic<long> sum{0};
+        std::atomic<int> finished{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUMBER_OF_THREADS; t++) {
+            threads.emplace_back([&scheduler] { scheduler.run(); });
+        }
+
+        int total = NUMBER_OF_CONSUMERS * MESSAGES_PER_CONSUMER;
+        for (int c = 0; c < NUMBER_OF_CONSUMERS; c++) {
+            consume(ring, sum, finished);
+        }
+        for (int p = 0; p < NUMBER_OF_THREADS; p++) {
+            int count = total / NUMBER_OF_THREADS;
+            threads.emplace_back([&ring, p, count] { produce(ring, p * count, count); });
+        }
+        while (finished.load() != NUMBER_OF_CONSUMERS) {
+            std::this_thread::yield();
+        }
+        scheduler.stop();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        long expected = (long)total * (total - 1) / 2;
+        if (sum.load() != expected) {
+            printf("Error: Test 3.1 failed. Expected sum %ld, got %ld\n", expected, sum.load());
+            exit(1);
+        }
+    }
+    printf("  + Test 3 passed\n");
+
+    printf("Test passed!\n");
+    return 0;
+}
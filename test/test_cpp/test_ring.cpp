@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/ringbuf.hpp"
+
+#define NUMBER_OF_STRINGS 10000
+#define CAPACITY 8
+
+static int alive = 0;
+
+struct Tracked {
+    explicit Tracked(int v) : value(v) { alive++; }
+    Tracked(Tracked &&other) : value(other.value) { alive++; }
+    ~Tracked() { alive--; }
+    int value;
+};
+
+int main() {
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Move-only elements in a single producer single consumer ring          *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Move-only elements\n");
+    {
+        rb::Ring<std::unique_ptr<int>, CAPACITY, rb::SpscSpin> ring;
+        for (int i = 0; i < CAPACITY; i++) {
+            if (!ring.try_push(std::make_unique<int>(i))) {
+                printf("Error: Test 1.1 failed. Push %d failed\n", i);
+                exit(1);
+            }
+        }
+        if (ring.try_push(std::make_unique<int>(CAPACITY))) {
+            printf("Error: Test 1.2 failed. Expected a full ring\n");
+            exit(1);
+        }
+        for (int i = 0; i < CAPACITY; i++) {
+            std::optional<std::unique_ptr<int>> value = ring.try_pop();
+            if (!value || **value != i) {
+                printf("Error: Test 1.3 failed. Pop %d failed\n", i);
+                exit(1);
+            }
+        }
+        if (ring.try_pop() || !ring.empty()) {
+            printf("Error: Test 1.4 failed. Expected an empty ring\n");
+            exit(1);
+        }
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Elements are constructed in place and destroyed with the ring         *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Element lifetime\n");
+    {
+        rb::Ring<Tracked, CAPACITY, rb::SpscBlock> ring;
+        ring.emplace(1);
+        ring.emplace(2);
+        ring.emplace(3);
+        if (alive != 3) {
+            printf("Error: Test 2.1 failed. Expected 3 live elements, got %d\n", alive);
+            exit(1);
+        }
+        if (ring.pop().value != 1) {
+            printf("Error: Test 2.2 failed. Wrong element popped\n");
+            exit(1);
+        }
+    }
+    if (alive != 0) {
+        printf("Error: Test 2.3 failed. %d elements leaked\n", alive);
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Blocking multi producer multi consumer ring                           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Multiple producers and consumers\n");
+    {
+        rb::Ring<std::string, CAPACITY, rb::MpmcBlock> ring;
+        std::vector<long> sums(2, 0);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 2; p++) {
+            threads.emplace_back([&ring, p] {
+                for (int i = p; i < NUMBER_OF_STRINGS; i += 2) {
+                    ring.push(std::to_string(i));
+                }
+            });
+        }
+        for (int c = 0; c < 2; c++) {
+            threads.emplace_back([&ring, &sums, c] {
+                for (int i = 0; i < NUMBER_OF_STRINGS / 2; i++) {
+                    sums[c] += std::stol(ring.pop());
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        long expected = (long)NUMBER_OF_STRINGS * (NUMBER_OF_STRINGS - 1) / 2;
+        if (sums[0] + sums[1] != expected) {
+            printf("Error: Test 3.1 failed. Expected sum %ld, got %ld\n", expected, sums[0] + sums[1]);
+            exit(1);
+        }
+    }
+    printf("  + Test 3 passed\n");
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "../../include/ringbuf_mpsc.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define NUMBER_OF_PRODUCERS 4
+#define MESSAGES_PER_PRODUCER 20000
+#define RBUF_SIZE 1024
+
+rbmpsc_t ring;
+
+void *producer(void *arg)
+{
+    int id = *(int *)arg;
+
+    for (int i = 0; i < MESSAGES_PER_PRODUCER; i++) {
+        // Varying lengths exercise padding at the end of the memory
+        int message[8] = {id, i};
+        size_t message_len = (2 + i % 7) * sizeof(int);
+        void *record;
+        while (ringbuffer_mpsc_reserve(&ring, message_len, &record) != SUCCESS) {
+            sched_yield();
+        }
+        memcpy(record, message, message_len);
+        if (i % 5 == 4) {
+            ringbuffer_mpsc_discard(&ring, record);
+        } else {
+            ringbuffer_mpsc_commit(&ring, record);
+        }
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    void *rbuf = malloc(RBUF_SIZE);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Records are read in order of reservation, once committed              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Reserve, commit and discard\n");
+
+    ringbuffer_mpsc_init(&ring, rbuf, 100);
+    if (ring.mask != 63) {
+        printf("Error: Test 1.1 failed. Expected 64 bytes, got %lu\n", (unsigned long)ring.mask + 1);
+        exit(1);
+    }
+    char buffer[64];
+    size_t buffer_len = sizeof(buffer);
+    void *first, *second;
+    assert(ringbuffer_mpsc_reserve(&ring, 5, &first) == SUCCESS);
+    assert(ringbuffer_mpsc_reserve(&ring, 3, &second) == SUCCESS);
+    memcpy(second, "two", 3);
+    ringbuffer_mpsc_commit(&ring, second);
+    if (ringbuffer_mpsc_read(&ring, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.2 failed. Read past a busy record\n");
+        exit(1);
+    }
+    memcpy(first, "one", 4);
+    ringbuffer_mpsc_discard(&ring, first);
+    if (ringbuffer_mpsc_read(&ring, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != 3 || memcmp(buffer, "two", 3) != 0) {
+        printf("Error: Test 1.3 failed. Discarded record was not skipped\n");
+        exit(1);
+    }
+    buffer_len = sizeof(buffer);
+    if (ringbuffer_mpsc_read(&ring, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.4 failed. Expected RINGBUFFER_EMPTY\n");
+        exit(1);
+    }
+    printf("Test 1 passed.\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Space runs out, records never wrap                                    *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Full ring and padding\n");
+
+    // Consumed up to offset 32, a 24 byte record fits at offset 32
+    char msg[] = "Hello World.";
+    assert(ringbuffer_mpsc_write(&ring, msg, sizeof(msg)) == SUCCESS);
+    // Would wrap at offset 56, goes to the start behind a padding record
+    void *record;
+    assert(ringbuffer_mpsc_reserve(&ring, sizeof(msg), &record) == SUCCESS);
+    if (record != (uint8_t *)rbuf + sizeof(uint64_t)) {
+        printf("Error: Test 2.1 failed. Record was not moved to the start\n");
+        exit(1);
+    }
+    memcpy(record, msg, sizeof(msg));
+    ringbuffer_mpsc_commit(&ring, record);
+    if (ringbuffer_mpsc_write(&ring, msg, sizeof(msg)) != RINGBUFFER_FULL) {
+        printf("Error: Test 2.2 failed. Expected RINGBUFFER_FULL\n");
+        exit(1);
+    }
+    buffer_len = 4;
+    if (ringbuffer_mpsc_read(&ring, buffer, &buffer_len) != OUTPUT_BUFFER_TOO_SMALL ||
+        buffer_len != sizeof(msg)) {
+        printf("Error: Test 2.3 failed. Expected OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+    for (int i = 0; i < 2; i++) {
+        buffer_len = sizeof(buffer);
+        if (ringbuffer_mpsc_read(&ring, buffer, &buffer_len) != SUCCESS ||
+            buffer_len != sizeof(msg) || strcmp(buffer, msg) != 0) {
+            printf("Error: Test 2.4 failed. Record %d was not read\n", i);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < 64; i++) {
+        if (((uint8_t *)rbuf)[i] != 0) {
+            printf("Error: Test 2.5 failed. Consumed byte %d was not zeroed\n", i);
+            exit(1);
+        }
+    }
+    printf("Test 2 passed.\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Many producers, one consumer                                          *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: %d producers\n", NUMBER_OF_PRODUCERS);
+
+    ringbuffer_mpsc_init(&ring, rbuf, RBUF_SIZE);
+    pthread_t producers[NUMBER_OF_PRODUCERS];
+    int ids[NUMBER_OF_PRODUCERS];
+    int next[NUMBER_OF_PRODUCERS] = {0};
+    for (int i = 0; i < NUMBER_OF_PRODUCERS; i++) {
+        ids[i] = i;
+        pthread_create(&producers[i], NULL, producer, &ids[i]);
+    }
+
+    int expected = NUMBER_OF_PRODUCERS * (MESSAGES_PER_PRODUCER - MESSAGES_PER_PRODUCER / 5);
+    for (int received = 0; received < expected; received++) {
+        int message[8];
+        buffer_len = sizeof(message);
+        while (ringbuffer_mpsc_read(&ring, message, &buffer_len) != SUCCESS) {
+            sched_yield();
+        }
+        int id = message[0];
+        int i = message[1];
+        if (id < 0 || id >= NUMBER_OF_PRODUCERS || buffer_len != (2 + i % 7) * sizeof(int)) {
+            printf("Error: Test 3.1 failed. Corrupt record\n");
+            exit(1);
+        }
+        // Discarded records leave gaps of one
+        if (next[id] % 5 == 4) {
+            next[id]++;
+        }
+        if (i != next[id]) {
+            printf("Error: Test 3.2 failed. Producer %d: expected %d, got %d\n", id, next[id], i);
+            exit(1);
+        }
+        next[id]++;
+    }
+
+    for (int i = 0; i < NUMBER_OF_PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    buffer_len = sizeof(buffer);
+    if (ringbuffer_mpsc_read(&ring, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 3.3 failed. Unexpected record\n");
+        exit(1);
+    }
+    printf("Test 3 passed.\n");
+
+    free(rbuf);
+    printf("All tests passed.\n");
+    return 0;
+}
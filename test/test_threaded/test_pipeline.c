@@ -0,0 +1,159 @@
+#include "../../include/ringbuf_pipeline.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+#include <ctype.h>
+
+#define NUMBER_OF_STRINGS 1000
+#define BUF_SIZE 50  // bytes
+#define RBUF_SIZE 512  // bytes
+
+/* stages of the pipeline */
+#define PARSE 0
+#define FILTER 1
+#define PERSIST 2
+
+char* strings[NUMBER_OF_STRINGS];
+char* result_strings[NUMBER_OF_STRINGS];
+int number_of_malicious = 0;
+
+void *writer(void *arg)
+{
+    rbpipeline_t *pipeline = (rbpipeline_t *)arg;
+
+    for (int i = 0; i < NUMBER_OF_STRINGS; i++) {
+        size_t str_len = strlen(strings[i]) + 1;
+        while (ringbuffer_pipeline_write(pipeline, strings[i], str_len) != SUCCESS) {
+        }
+    }
+
+    return NULL;
+}
+
+void *parse(void *arg)
+{
+    rbpipeline_t *pipeline = (rbpipeline_t *)arg;
+
+    for (int i = 0; i < NUMBER_OF_STRINGS; i++) {
+        char *msg;
+        size_t msg_len;
+        while (ringbuffer_pipeline_acquire(pipeline, PARSE, (void **)&msg, &msg_len) != SUCCESS) {
+        }
+        /* work in place, the next stage sees the modified message */
+        for (size_t j = 0; j < msg_len; j++) {
+            msg[j] = toupper(msg[j]);
+        }
+        ringbuffer_pipeline_release(pipeline, PARSE);
+    }
+
+    return NULL;
+}
+
+void *filter(void *arg)
+{
+    rbpipeline_t *pipeline = (rbpipeline_t *)arg;
+
+    for (int i = 0; i < NUMBER_OF_STRINGS; i++) {
+        char *msg;
+        size_t msg_len;
+        while (ringbuffer_pipeline_acquire(pipeline, FILTER, (void **)&msg, &msg_len) != SUCCESS) {
+        }
+        if (strstr(msg, "MALICIOUS") != NULL) {
+            ringbuffer_pipeline_discard(pipeline, FILTER);
+        } else {
+            ringbuffer_pipeline_release(pipeline, FILTER);
+        }
+    }
+
+    return NULL;
+}
+
+void *persist(void *arg)
+{
+    rbpipeline_t *pipeline = (rbpipeline_t *)arg;
+
+    for (int i = 0; i < NUMBER_OF_STRINGS - number_of_malicious; i++) {
+        char *msg;
+        size_t msg_len;
+        while (ringbuffer_pipeline_acquire(pipeline, PERSIST, (void **)&msg, &msg_len) != SUCCESS) {
+        }
+        result_strings[i] = malloc(msg_len);
+        memcpy(result_strings[i], msg, msg_len);
+        ringbuffer_pipeline_release(pipeline, PERSIST);
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    /* array of random strings, every 7th is malicious */
+    for (int i = 0; i < NUMBER_OF_STRINGS; i++) {
+        int len = rand() % BUF_SIZE;
+        char* str = malloc(len + 1 + strlen("malicious"));
+        if (str == NULL) {
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        for (int j = 0; j < len; j++) {
+            str[j] = 'a' + (rand() % 26);
+        }
+        str[len] = '\0';
+        if (i % 7 == 0) {
+            strcat(str, "malicious");
+            number_of_malicious++;
+        }
+        strings[i] = str;
+    }
+
+    char* rbuf = malloc(RBUF_SIZE);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    rbpipeline_t pipeline;
+    ringbuffer_pipeline_init(&pipeline, rbuf, RBUF_SIZE, 3);
+
+    printf("creating writer and stage threads\n");
+    pthread_t w_id, parse_id, filter_id, persist_id;
+    pthread_create(&w_id, NULL, writer, &pipeline);
+    pthread_create(&parse_id, NULL, parse, &pipeline);
+    pthread_create(&filter_id, NULL, filter, &pipeline);
+    pthread_create(&persist_id, NULL, persist, &pipeline);
+
+    pthread_join(w_id, NULL);
+    pthread_join(parse_id, NULL);
+    pthread_join(filter_id, NULL);
+    pthread_join(persist_id, NULL);
+    printf("threads joined\n");
+
+    /* the last stage has to see every benign string, in order and parsed */
+    int idx = 0;
+    for (int i = 0; i < NUMBER_OF_STRINGS; i++) {
+        if (i % 7 == 0) {
+            continue;
+        }
+        for (size_t j = 0; j <= strlen(strings[i]); j++) {
+            if (toupper(strings[i][j]) != result_strings[idx][j]) {
+                printf("Error: string %d was not parsed correctly\n", i);
+                printf("Expected: %s, Got: %s\n", strings[i], result_strings[idx]);
+                exit(1);
+            }
+        }
+        idx++;
+    }
+
+    ringbuffer_pipeline_destroy(&pipeline);
+    free(rbuf);
+    for (int i = 0; i < NUMBER_OF_STRINGS; i++) {
+        free(strings[i]);
+    }
+    for (int i = 0; i < idx; i++) {
+        free(result_strings[i]);
+    }
+
+    printf("Test passed!\n");
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "../../include/ringbuf.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#define NUMBER_OF_RINGS 3
+#define NUMBER_OF_MESSAGES 1000
+#define RBUF_SIZE 256  // bytes
+
+rbctx_t contexts[NUMBER_OF_RINGS];
+rbctx_t *rings[NUMBER_OF_RINGS];
+
+double elapsed_ms(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void *delayed_writer(void *arg)
+{
+    usleep(50000);
+    char msg[] = "late";
+    ringbuffer_write(rings[*(int *)arg], msg, sizeof(msg));
+    return NULL;
+}
+
+void *writer(void *arg)
+{
+    int first = *(int *)arg;
+    for (int i = 0; i < NUMBER_OF_MESSAGES; i++) {
+        int ring = (first + i) % NUMBER_OF_RINGS;
+        while (ringbuffer_write(rings[ring], &i, sizeof(int)) != SUCCESS) {
+        }
+        if (i % 100 == 0) {
+            usleep(1000);
+        }
+    }
+    return NULL;
+}
+
+int main()
+{
+    char *memory[NUMBER_OF_RINGS];
+    for (int i = 0; i < NUMBER_OF_RINGS; i++) {
+        memory[i] = malloc(RBUF_SIZE);
+        if (memory[i] == NULL) {
+            printf("Error: malloc failed\n");
+            exit(1);
+        }
+        ringbuffer_init(&contexts[i], memory[i], RBUF_SIZE);
+        ringbuffer_set_flags(&contexts[i], RBUF_FLAG_NONBLOCK);
+        rings[i] = &contexts[i];
+    }
+
+    int ready[NUMBER_OF_RINGS];
+    char buffer[100];
+    size_t buffer_len = 100;
+    struct timespec start;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Ready rings are reported without waiting                              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Check readiness\n");
+
+    if (ringbuffer_poll(rings, NUMBER_OF_RINGS, 0, ready) != 0) {
+        printf("Error: Test 1.1 failed. Empty rings reported ready\n");
+        exit(1);
+    }
+    char msg[] = "Hello World.";
+    ringbuffer_write(rings[2], msg, sizeof(msg));
+    if (ringbuffer_poll(rings, NUMBER_OF_RINGS, -1, ready) != 1 ||
+        ready[0] || ready[1] || !ready[2]) {
+        printf("Error: Test 1.2 failed. Expected only ring 2 to be ready\n");
+        exit(1);
+    }
+    assert(ringbuffer_read(rings[2], buffer, &buffer_len) == SUCCESS);
+    printf("Test 1 passed.\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Timeouts and waking up on a write                                     *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Block until a ring has data\n");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (ringbuffer_poll(rings, NUMBER_OF_RINGS, 100, ready) != 0 || elapsed_ms(&start) < 95) {
+        printf("Error: Test 2.1 failed. Did not wait for the timeout\n");
+        exit(1);
+    }
+
+    pthread_t thread;
+    int target = 1;
+    pthread_create(&thread, NULL, delayed_writer, &target);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int nr_ready = ringbuffer_poll(rings, NUMBER_OF_RINGS, 5000, ready);
+    double waited = elapsed_ms(&start);
+    pthread_join(thread, NULL);
+    if (nr_ready != 1 || !ready[1] || waited < 40 || waited > 2000) {
+        printf("Error: Test 2.2 failed. Woke up after %.1f ms with %d ready rings\n", waited, nr_ready);
+        exit(1);
+    }
+    buffer_len = 100;
+    assert(ringbuffer_read(rings[1], buffer, &buffer_len) == SUCCESS);
+    for (int i = 0; i < NUMBER_OF_RINGS; i++) {
+        if (rings[i]->waiters != NULL) {
+            printf("Error: Test 2.3 failed. Waiter left on ring %d\n", i);
+            exit(1);
+        }
+    }
+    printf("Test 2 passed.\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * One consumer serves several rings                                     *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Consume %d messages from %d rings\n", 2 * NUMBER_OF_MESSAGES, NUMBER_OF_RINGS);
+
+    pthread_t writers[2];
+    int firsts[2] = {0, 1};
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&writers[i], NULL, writer, &firsts[i]);
+    }
+    int received = 0;
+    long sum = 0;
+    while (received < 2 * NUMBER_OF_MESSAGES) {
+        if (ringbuffer_poll(rings, NUMBER_OF_RINGS, 5000, ready) <= 0) {
+            printf("Error: Test 3 failed. Poll timed out after %d messages\n", received);
+            exit(1);
+        }
+        for (int i = 0; i < NUMBER_OF_RINGS; i++) {
+            int value;
+            size_t value_len = sizeof(int);
+            while (ready[i] && ringbuffer_read(rings[i], &value, &value_len) == SUCCESS) {
+                sum += value;
+                received++;
+                value_len = sizeof(int);
+            }
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    long expected = (long)NUMBER_OF_MESSAGES * (NUMBER_OF_MESSAGES - 1);
+    if (sum != expected) {
+        printf("Error: Test 3 failed. Expected sum %ld, got %ld\n", expected, sum);
+        exit(1);
+    }
+    printf("Test 3 passed.\n");
+
+    for (int i = 0; i < NUMBER_OF_RINGS; i++) {
+        ringbuffer_destroy(&contexts[i]);
+        free(memory[i]);
+    }
+
+    printf("--------------------------------------------------------\n");
+    printf("All tests passed.\n");
+    return 0;
+}
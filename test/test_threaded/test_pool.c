@@ -0,0 +1,172 @@
+#include "../../include/ringbuf_pool.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define NUMBER_OF_MESSAGES 2000
+#define NUMBER_OF_PRODUCERS 2
+#define NUMBER_OF_CONSUMERS 2
+#define MESSAGE_SIZE (64 * 1024)  // bytes
+#define NUMBER_OF_BUFFERS 8
+#define RBUF_SLOTS 4
+
+rbctx_t ringbuffer_context;
+rbpool_t pool;
+int received[NUMBER_OF_MESSAGES];
+
+void *producer(void *arg)
+{
+    int first = *(int *)arg;
+
+    for (int i = first; i < NUMBER_OF_MESSAGES; i += NUMBER_OF_PRODUCERS) {
+        rbhandle_t handle;
+        while (ringbuffer_pool_acquire(&pool, &handle) != SUCCESS) {
+            sched_yield();
+        }
+        /* fill the buffer in place, only the handle is copied */
+        int *data = ringbuffer_pool_data(&pool, handle);
+        handle.length = MESSAGE_SIZE - (i % 100);
+        for (size_t j = 0; j < handle.length / sizeof(int); j++) {
+            data[j] = i;
+        }
+        while (ringbuffer_write_handle(&ringbuffer_context, handle) != SUCCESS) {
+        }
+    }
+
+    return NULL;
+}
+
+void *consumer(void *arg)
+{
+    (void)arg;
+
+    for (int i = 0; i < NUMBER_OF_MESSAGES / NUMBER_OF_CONSUMERS; i++) {
+        rbhandle_t handle;
+        while (ringbuffer_read_handle(&ringbuffer_context, &handle) != SUCCESS) {
+            sched_yield();
+        }
+        int *data = ringbuffer_pool_data(&pool, handle);
+        int id = data[0];
+        if (id < 0 || id >= NUMBER_OF_MESSAGES ||
+            handle.length != (uint32_t)(MESSAGE_SIZE - (id % 100))) {
+            printf("Error: Test 2 failed. Corrupt handle\n");
+            exit(1);
+        }
+        for (size_t j = 0; j < handle.length / sizeof(int); j++) {
+            if (data[j] != id) {
+                printf("Error: Test 2 failed. Buffer of message %d was overwritten\n", id);
+                exit(1);
+            }
+        }
+        __atomic_add_fetch(&received[id], 1, __ATOMIC_RELAXED);
+        ringbuffer_pool_release(&pool, handle);
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    size_t pool_size = NUMBER_OF_BUFFERS * MESSAGE_SIZE;
+    void *pool_memory = malloc(pool_size);
+    void *rbuf = malloc(RBUF_SLOTS * sizeof(rbhandle_t));
+    if (pool_memory == NULL || rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Buffers run out and come back                                         *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Acquire and release\n");
+
+    ringbuffer_pool_init(&pool, pool_memory, pool_size, MESSAGE_SIZE);
+    if (pool.nr_of_buffers != NUMBER_OF_BUFFERS) {
+        printf("Error: Test 1.1 failed. Expected %d buffers, got %u\n", NUMBER_OF_BUFFERS, pool.nr_of_buffers);
+        exit(1);
+    }
+    rbhandle_t handles[NUMBER_OF_BUFFERS];
+    for (int i = 0; i < NUMBER_OF_BUFFERS; i++) {
+        if (ringbuffer_pool_acquire(&pool, &handles[i]) != SUCCESS) {
+            printf("Error: Test 1.2 failed. Acquire %d failed\n", i);
+            exit(1);
+        }
+        for (int j = 0; j < i; j++) {
+            if (handles[j].index == handles[i].index) {
+                printf("Error: Test 1.3 failed. Buffer %u handed out twice\n", handles[i].index);
+                exit(1);
+            }
+        }
+    }
+    rbhandle_t extra;
+    if (ringbuffer_pool_acquire(&pool, &extra) != RINGBUFFER_FULL) {
+        printf("Error: Test 1.4 failed. Expected an exhausted pool\n");
+        exit(1);
+    }
+    ringbuffer_pool_release(&pool, handles[3]);
+    if (ringbuffer_pool_acquire(&pool, &extra) != SUCCESS || extra.index != handles[3].index) {
+        printf("Error: Test 1.5 failed. Released buffer was not reused\n");
+        exit(1);
+    }
+    ringbuffer_pool_release(&pool, extra);
+    for (int i = 0; i < NUMBER_OF_BUFFERS; i++) {
+        if (i != 3) {
+            ringbuffer_pool_release(&pool, handles[i]);
+        }
+    }
+    printf("Test 1 passed.\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Large messages passed by handle between threads                       *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: %d messages of %d KiB through a %d slot ring\n", NUMBER_OF_MESSAGES, MESSAGE_SIZE / 1024, RBUF_SLOTS);
+
+    ringbuffer_init_slots(&ringbuffer_context, rbuf, RBUF_SLOTS * sizeof(rbhandle_t), sizeof(rbhandle_t));
+
+    pthread_t producers[NUMBER_OF_PRODUCERS];
+    pthread_t consumers[NUMBER_OF_CONSUMERS];
+    int firsts[NUMBER_OF_PRODUCERS];
+    for (int i = 0; i < NUMBER_OF_CONSUMERS; i++) {
+        pthread_create(&consumers[i], NULL, consumer, NULL);
+    }
+    for (int i = 0; i < NUMBER_OF_PRODUCERS; i++) {
+        firsts[i] = i;
+        pthread_create(&producers[i], NULL, producer, &firsts[i]);
+    }
+    for (int i = 0; i < NUMBER_OF_PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    for (int i = 0; i < NUMBER_OF_CONSUMERS; i++) {
+        pthread_join(consumers[i], NULL);
+    }
+
+    for (int i = 0; i < NUMBER_OF_MESSAGES; i++) {
+        if (received[i] != 1) {
+            printf("Error: Test 2 failed. Message %d received %d times\n", i, received[i]);
+            exit(1);
+        }
+    }
+    int free_buffers = 0;
+    while (ringbuffer_pool_acquire(&pool, &extra) == SUCCESS) {
+        free_buffers++;
+    }
+    if (free_buffers != NUMBER_OF_BUFFERS) {
+        printf("Error: Test 2 failed. %d buffers leaked\n", NUMBER_OF_BUFFERS - free_buffers);
+        exit(1);
+    }
+    printf("Test 2 passed.\n");
+
+    ringbuffer_destroy(&ringbuffer_context);
+    free(rbuf);
+    free(pool_memory);
+
+    printf("--------------------------------------------------------\n");
+    printf("All tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/crc32c.h"
+#include "../../include/ringbuf.h"
+
+/* table driven fallback, used when the cpu has no crc32 instruction */
+uint32_t crc32c_copy_sw(uint32_t crc, uint8_t *dst, const uint8_t *src, size_t len);
+
+int main() {
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * CRC-32C check value, hardware and software agree                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: CRC-32C\n");
+
+    const char *check = "123456789";
+    if (crc32c_final(crc32c_update(crc32c_init(), check, 9)) != 0xE3069283) {
+        printf("Error: Test 1.1 failed. Wrong check value\n");
+        exit(1);
+    }
+
+    char text[1000];
+    char copy[1000];
+    for (int i = 0; i < 1000; i++) {
+        text[i] = rand();
+    }
+    for (size_t len = 0; len < 40; len++) {
+        uint32_t crc = crc32c_copy(crc32c_init(), copy, text + 3, len);
+        uint32_t crc_sw = crc32c_copy_sw(crc32c_init(), NULL, (uint8_t*) text + 3, len);
+        if (crc != crc_sw || memcmp(copy, text + 3, len) != 0) {
+            printf("Error: Test 1.2 failed for %zu bytes\n", len);
+            exit(1);
+        }
+    }
+
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Checksummed messages across wrap arounds                              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Read and write checksummed messages\n");
+
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 100;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM);
+
+    char buffer[100];
+    size_t buffer_len;
+    for (int i = 0; i < 50; i++) {
+        size_t msg_len = 1 + rand() % 60;
+        if (ringbuffer_write(ringbuffer_context, text + i, msg_len) != SUCCESS) {
+            printf("Error: Test 2.1 failed. Write %d failed\n", i);
+            exit(1);
+        }
+        /* length, checksums and content */
+        size_t used = (ringbuffer_context->write - ringbuffer_context->read + rbuf_size) % rbuf_size;
+        if (used != sizeof(size_t) + 2 * sizeof(uint32_t) + msg_len) {
+            printf("Error: Test 2.2 failed. Wrong frame size\n");
+            exit(1);
+        }
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS) {
+            printf("Error: Test 2.3 failed. Read %d failed\n", i);
+            exit(1);
+        }
+        if (buffer_len != msg_len || memcmp(buffer, text + i, msg_len) != 0) {
+            printf("Error: Test 2.4 failed. Message %d does not match\n", i);
+            exit(1);
+        }
+    }
+
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * A corrupted message is detected                                       *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Detect corruption\n");
+
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM);
+    assert(ringbuffer_write(ringbuffer_context, text, 20) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, text, 20) == SUCCESS);
+
+    rbuf[sizeof(size_t) + 2 * sizeof(uint32_t) + 5] ^= 1;
+
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != CHECKSUM_MISMATCH) {
+        printf("Error: Test 3.1 failed. Expected CHECKSUM_MISMATCH\n");
+        exit(1);
+    }
+
+    /* the corrupted message is consumed, the next one is intact */
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS) {
+        printf("Error: Test 3.2 failed. Expected SUCCESS\n");
+        exit(1);
+    }
+
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * A corrupted length does not break the framing                         *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Detect a corrupted header\n");
+
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM | RBUF_FLAG_NONBLOCK);
+    for (int i = 0; i < 3; i++) {
+        assert(ringbuffer_write(ringbuffer_context, text, 12) == SUCCESS);
+    }
+    rbuf[0] = 20;
+
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != CHECKSUM_MISMATCH) {
+        printf("Error: Test 4.1 failed. Expected CHECKSUM_MISMATCH\n");
+        exit(1);
+    }
+    /* where the next message starts is unknown, nothing is left */
+    buffer_len = 100;
+    if (ringbuffer_context->read != ringbuffer_context->write ||
+        ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 4.2 failed. Expected an empty ringbuffer\n");
+        exit(1);
+    }
+
+    /* a message that does not fit the buffer stays in place */
+    assert(ringbuffer_write(ringbuffer_context, text, 12) == SUCCESS);
+    buffer_len = 4;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != OUTPUT_BUFFER_TOO_SMALL) {
+        printf("Error: Test 4.3 failed. Expected OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != 12 || memcmp(buffer, text, 12) != 0) {
+        printf("Error: Test 4.4 failed. Message was not kept\n");
+        exit(1);
+    }
+
+    printf("  + Test 4 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
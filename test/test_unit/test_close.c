@@ -0,0 +1,188 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+typedef struct {
+    rbctx_t *ring;
+    int result;
+    uint64_t waited_ns;
+} blocked_t;
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void *blocked_write(void *arg) {
+    blocked_t *blocked = arg;
+    char msg[] = "Hello World.";
+    uint64_t start = now_ns();
+    blocked->result = ringbuffer_write(blocked->ring, msg, sizeof(msg));
+    blocked->waited_ns = now_ns() - start;
+    return NULL;
+}
+
+void *finish_large_read(void *arg) {
+    rbctx_t *ring = arg;
+    usleep(100000);
+    pthread_mutex_lock(&ring->mtx);
+    ring->large_reader = 0;
+    pthread_cond_broadcast(&ring->sig);
+    pthread_mutex_unlock(&ring->mtx);
+    return NULL;
+}
+
+void *blocked_poll(void *arg) {
+    blocked_t *blocked = arg;
+    int ready;
+    uint64_t start = now_ns();
+    blocked->result = ringbuffer_poll(&blocked->ring, 1, -1, &ready);
+    blocked->waited_ns = now_ns() - start;
+    return NULL;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+
+    size_t rbuf_size = 3 * (msg_len + sizeof(size_t)); // two messages fit
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+
+    char buffer[100];
+    size_t buffer_len = 100;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Readers drain a closed ringbuffer, writers are refused                *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Drain after close\n");
+
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    ringbuffer_close(ringbuffer_context);
+    if (ringbuffer_write(ringbuffer_context, msg, msg_len) != RINGBUFFER_CLOSED) {
+        printf("Error: Test 1.1 failed. Write after close did not fail\n");
+        exit(1);
+    }
+    for (int i = 0; i < 2; i++) {
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            strcmp(buffer, msg) != 0) {
+            printf("Error: Test 1.2 failed. Message %d was not drained\n", i);
+            exit(1);
+        }
+    }
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_CLOSED) {
+        printf("Error: Test 1.3 failed. Expected RINGBUFFER_CLOSED\n");
+        exit(1);
+    }
+    uint8_t stage[64];
+    rbtxn_t txn;
+    ringbuffer_txn_begin(&txn, ringbuffer_context, stage, sizeof(stage));
+    assert(ringbuffer_txn_append(&txn, msg, msg_len) == SUCCESS);
+    if (ringbuffer_txn_commit(&txn) != RINGBUFFER_CLOSED) {
+        printf("Error: Test 1.4 failed. Commit after close did not fail\n");
+        exit(1);
+    }
+    ringbuffer_destroy(ringbuffer_context);
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Waiting writers and pollers wake up right away                        *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Wake waiting threads\n");
+
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    int readable_fd = ringbuffer_readable_fd(ringbuffer_context);
+    uint64_t count;
+    assert(read(readable_fd, &count, sizeof(count)) == sizeof(count));
+
+    rbctx_t *empty_context = malloc(sizeof(rbctx_t));
+    char empty_rbuf[64];
+    ringbuffer_init(empty_context, empty_rbuf, sizeof(empty_rbuf));
+
+    blocked_t writer = {ringbuffer_context, -1, 0};
+    blocked_t poller = {empty_context, -1, 0};
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, blocked_write, &writer);
+    pthread_create(&threads[1], NULL, blocked_poll, &poller);
+    usleep(100000);
+    ringbuffer_close(ringbuffer_context);
+    ringbuffer_close(empty_context);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    if (writer.result != RINGBUFFER_CLOSED || writer.waited_ns > 500000000) {
+        printf("Error: Test 2.1 failed. Writer got %d after %lu ms\n", writer.result,
+               (unsigned long)(writer.waited_ns / 1000000));
+        exit(1);
+    }
+    if (poller.result != 1) {
+        printf("Error: Test 2.2 failed. Poll returned %d\n", poller.result);
+        exit(1);
+    }
+    if (read(readable_fd, &count, sizeof(count)) != sizeof(count)) {
+        printf("Error: Test 2.3 failed. Close did not signal the eventfd\n");
+        exit(1);
+    }
+    buffer_len = 100;
+    if (ringbuffer_read(empty_context, buffer, &buffer_len) != RINGBUFFER_CLOSED) {
+        printf("Error: Test 2.4 failed. Expected RINGBUFFER_CLOSED\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Fragmented reads end with RINGBUFFER_CLOSED too                       *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Fragmented read after close\n");
+
+    buffer_len = 100;
+    if (ringbuffer_read_large(empty_context, buffer, &buffer_len) != RINGBUFFER_CLOSED) {
+        printf("Error: Test 3.1 failed. Expected RINGBUFFER_CLOSED\n");
+        exit(1);
+    }
+    // Behind a reader that is still busy with a message when the ring closes
+    empty_context->large_reader = 1;
+    pthread_t finisher;
+    pthread_create(&finisher, NULL, finish_large_read, empty_context);
+    buffer_len = 100;
+    if (ringbuffer_read_large(empty_context, buffer, &buffer_len) != RINGBUFFER_CLOSED) {
+        printf("Error: Test 3.2 failed. Expected RINGBUFFER_CLOSED\n");
+        exit(1);
+    }
+    pthread_join(finisher, NULL);
+    printf("  + Test 3 passed\n");
+
+    ringbuffer_destroy(empty_context);
+    ringbuffer_destroy(ringbuffer_context);
+    free(empty_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+#define STAGE_SIZE 100
+
+/*
+ * Number of messages that can be read right now
+ */
+int drain(rbctx_t *context) {
+    char buffer[100];
+    size_t buffer_len = 100;
+    int count = 0;
+    while (ringbuffer_read(context, buffer, &buffer_len) == SUCCESS) {
+        buffer_len = 100;
+        count++;
+    }
+    return count;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    rbcoalesce_t *coalescer = malloc(sizeof(rbcoalesce_t));
+    if (ringbuffer_context == NULL || coalescer == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+    size_t record_len = msg_len + sizeof(size_t);
+
+    size_t rbuf_size = 1000;
+    char* rbuf = malloc(rbuf_size);
+    char* stage = malloc(STAGE_SIZE);
+    if (rbuf == NULL || stage == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Staged messages are published on flush, in order                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Explicit flush\n");
+
+    ringbuffer_coalesce_init(coalescer, ringbuffer_context, stage, STAGE_SIZE, 0, 0);
+    for (int i = 0; i < 3; i++) {
+        msg[0] = 'A' + i;
+        assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    }
+    if (drain(ringbuffer_context) != 0) {
+        printf("Error: Test 1.1 failed. Messages published before the flush\n");
+        exit(1);
+    }
+    assert(ringbuffer_flush(coalescer) == SUCCESS);
+    for (int i = 0; i < 3; i++) {
+        char buffer[100];
+        size_t buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer_len != msg_len || buffer[0] != 'A' + i) {
+            printf("Error: Test 1.2 failed. Message %d wrong after flush\n", i);
+            exit(1);
+        }
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Message count and staging memory thresholds                           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Count and byte thresholds\n");
+
+    ringbuffer_coalesce_init(coalescer, ringbuffer_context, stage, STAGE_SIZE, 2, 0);
+    assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    if (drain(ringbuffer_context) != 0) {
+        printf("Error: Test 2.1 failed. Published below the message count\n");
+        exit(1);
+    }
+    assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    if (drain(ringbuffer_context) != 2) {
+        printf("Error: Test 2.2 failed. Not published at the message count\n");
+        exit(1);
+    }
+
+    ringbuffer_coalesce_init(coalescer, ringbuffer_context, stage, STAGE_SIZE, 0, 0);
+    int fitting = STAGE_SIZE / record_len;
+    for (int i = 0; i < fitting; i++) {
+        assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    }
+    if (drain(ringbuffer_context) != 0) {
+        printf("Error: Test 2.3 failed. Published before the stage was full\n");
+        exit(1);
+    }
+    assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    if (drain(ringbuffer_context) != fitting || coalescer->staged_messages != 1) {
+        printf("Error: Test 2.4 failed. Full stage was not published\n");
+        exit(1);
+    }
+    assert(ringbuffer_flush(coalescer) == SUCCESS);
+    drain(ringbuffer_context);
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Deadline                                                              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Deadline\n");
+
+    ringbuffer_coalesce_init(coalescer, ringbuffer_context, stage, STAGE_SIZE, 0, 1000);
+    assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_coalesce_poll(coalescer) == SUCCESS);
+    if (drain(ringbuffer_context) != 0) {
+        printf("Error: Test 3.1 failed. Published before the deadline\n");
+        exit(1);
+    }
+    usleep(2000);
+    assert(ringbuffer_coalesce_poll(coalescer) == SUCCESS);
+    if (drain(ringbuffer_context) != 1) {
+        printf("Error: Test 3.2 failed. Not published after the deadline\n");
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * Large messages and a full ringbuffer                                  *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Large messages and a full ringbuffer\n");
+
+    ringbuffer_coalesce_init(coalescer, ringbuffer_context, stage, STAGE_SIZE, 0, 0);
+    char large[200] = {0};
+    assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    if (ringbuffer_coalesce_write(coalescer, large, 99) != SUCCESS ||
+        coalescer->staged_messages != 0) {
+        printf("Error: Test 4.1 failed. Large message was not written through\n");
+        exit(1);
+    }
+    char buffer[100];
+    size_t buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != msg_len) {
+        printf("Error: Test 4.2 failed. Staged message did not come first\n");
+        exit(1);
+    }
+    drain(ringbuffer_context);
+
+    char huge[1000] = {0};
+    if (ringbuffer_coalesce_write(coalescer, huge, sizeof(huge)) != RINGBUFFER_FULL) {
+        printf("Error: Test 4.3 failed. Message larger than the ring accepted\n");
+        exit(1);
+    }
+
+    size_t in_ring = 0;
+    while (ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS) {
+        in_ring++;
+    }
+    assert(ringbuffer_coalesce_write(coalescer, msg, msg_len) == SUCCESS);
+    if (ringbuffer_flush(coalescer) != RINGBUFFER_FULL ||
+        coalescer->staged_messages != 1) {
+        printf("Error: Test 4.4 failed. Message lost on a full ringbuffer\n");
+        exit(1);
+    }
+    assert((size_t)drain(ringbuffer_context) == in_ring);
+    if (ringbuffer_flush(coalescer) != SUCCESS || drain(ringbuffer_context) != 1) {
+        printf("Error: Test 4.5 failed. Message not published after draining\n");
+        exit(1);
+    }
+    printf("  + Test 4 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(stage);
+    free(rbuf);
+    free(coalescer);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
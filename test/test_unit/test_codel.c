@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+#define NUMBER_OF_MESSAGES 50
+#define TARGET_US 1000
+#define INTERVAL_US 10000
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Fill the ringbuffer, then read it slowly enough for every message to stay
+ * above the target. Returns the number of messages delivered.
+ */
+int slow_drain(rbctx_t *context, int *marked) {
+    int delivered = 0;
+    for (int i = 0; i < NUMBER_OF_MESSAGES; i++) {
+        int value = i;
+        assert(ringbuffer_write(context, &value, sizeof(int)) == SUCCESS);
+    }
+    usleep(2 * TARGET_US);
+
+    rbmeta_t meta;
+    int value;
+    size_t value_len = sizeof(int);
+    while (ringbuffer_read_meta(context, &value, &value_len, &meta) == SUCCESS) {
+        delivered++;
+        *marked += meta.marked;
+        value_len = sizeof(int);
+        usleep(INTERVAL_US / 4);
+    }
+    return delivered;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 4096;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+    char buffer[100];
+    size_t buffer_len = 100;
+    rbmeta_t meta;
+    rbstats_t stats;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Enqueue timestamps                                                    *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Enqueue timestamps\n");
+
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_TIMESTAMP | RBUF_FLAG_CHECKSUM);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    usleep(2000);
+    if (ringbuffer_read_meta(ringbuffer_context, buffer, &buffer_len, &meta) != SUCCESS ||
+        buffer_len != msg_len || strcmp(buffer, msg) != 0) {
+        printf("Error: Test 1.1 failed. Timestamped message was not read\n");
+        exit(1);
+    }
+    if (meta.enqueued_ns == 0 || meta.sojourn_ns < 2000000 || meta.marked) {
+        printf("Error: Test 1.2 failed. Sojourn time %lu ns\n", (unsigned long)meta.sojourn_ns);
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * A standing queue is shed, fresh messages are not                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: CoDel drops\n");
+
+    ringbuffer_set_flags(ringbuffer_context,
+                         RBUF_FLAG_TIMESTAMP | RBUF_FLAG_STATS | RBUF_FLAG_NONBLOCK);
+    ringbuffer_set_codel(ringbuffer_context, TARGET_US, INTERVAL_US, 0);
+    int marked = 0;
+    int delivered = slow_drain(ringbuffer_context, &marked);
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.dropped == 0 || marked != 0 ||
+        delivered + stats.dropped != NUMBER_OF_MESSAGES) {
+        printf("Error: Test 2.1 failed. %d delivered, %lu dropped\n", delivered,
+               (unsigned long)stats.dropped);
+        exit(1);
+    }
+
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        ringbuffer_context->codel.dropping) {
+        printf("Error: Test 2.2 failed. Fresh message was dropped\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Marking instead of dropping                                           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: CoDel marks\n");
+
+    ringbuffer_set_codel(ringbuffer_context, TARGET_US, INTERVAL_US, 1);
+    uint64_t dropped_before = stats.dropped;
+    marked = 0;
+    delivered = slow_drain(ringbuffer_context, &marked);
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (delivered != NUMBER_OF_MESSAGES || marked == 0 ||
+        stats.marked != (uint64_t)marked || stats.dropped != dropped_before) {
+        printf("Error: Test 3.1 failed. %d delivered, %d marked\n", delivered, marked);
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * A new episode resumes the previous rate while its next drop is ahead  *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: CoDel resumes\n");
+
+    ringbuffer_set_codel(ringbuffer_context, TARGET_US, INTERVAL_US, 1);
+    // The last episode ended right away, after 5 drops of which 1 was carried
+    ringbuffer_context->codel.count = 5;
+    ringbuffer_context->codel.last_count = 1;
+    ringbuffer_context->codel.first_above_ns = now_ns();
+    ringbuffer_context->codel.drop_next_ns = now_ns() + 1000 * INTERVAL_US;
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    usleep(2 * TARGET_US);
+    buffer_len = 100;
+    if (ringbuffer_read_meta(ringbuffer_context, buffer, &buffer_len, &meta) != SUCCESS ||
+        !meta.marked) {
+        printf("Error: Test 4.1 failed. Expected a marked message\n");
+        exit(1);
+    }
+    if (ringbuffer_context->codel.count != 4) {
+        printf("Error: Test 4.2 failed. Expected count 4, got %u\n",
+               ringbuffer_context->codel.count);
+        exit(1);
+    }
+    printf("  + Test 4 passed\n");
+
+    /*************************************************************************
+     * TEST 5:                                                               *
+     * Retries after OUTPUT_BUFFER_TOO_SMALL are not counted again           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 5: CoDel and short buffers\n");
+
+    ringbuffer_set_codel(ringbuffer_context, TARGET_US, INTERVAL_US, 1);
+    ringbuffer_context->codel.first_above_ns = now_ns();
+    ringbuffer_stats(ringbuffer_context, &stats);
+    uint64_t marked_before = stats.marked;
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    usleep(2 * TARGET_US);
+    for (int i = 0; i < 3; i++) {
+        buffer_len = 4;
+        if (ringbuffer_read_meta(ringbuffer_context, buffer, &buffer_len, &meta) !=
+            OUTPUT_BUFFER_TOO_SMALL) {
+            printf("Error: Test 5.1 failed. Expected OUTPUT_BUFFER_TOO_SMALL\n");
+            exit(1);
+        }
+    }
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.marked != marked_before || ringbuffer_context->codel.dropping) {
+        printf("Error: Test 5.2 failed. Message was marked before it was read\n");
+        exit(1);
+    }
+    buffer_len = 100;
+    if (ringbuffer_read_meta(ringbuffer_context, buffer, &buffer_len, &meta) != SUCCESS ||
+        !meta.marked || ringbuffer_context->codel.count != 1) {
+        printf("Error: Test 5.3 failed. Expected a marked message\n");
+        exit(1);
+    }
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.marked != marked_before + 1) {
+        printf("Error: Test 5.4 failed. %lu marks for one message\n",
+               (unsigned long)(stats.marked - marked_before));
+        exit(1);
+    }
+    printf("  + Test 5 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
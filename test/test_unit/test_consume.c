@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf.h"
+
+typedef struct {
+    char joined[10][100];
+    int count;
+    int stop_at;  // stop after this many visits, 0 never
+    int wrapped;  // visits that got two spans
+    const char *lowest;
+    const char *highest;
+} visits_t;
+
+int record_visit(void *user, const void *data, size_t len, const void *wrapped,
+                 size_t wrapped_len) {
+    visits_t *visits = user;
+    if ((const char *)data < visits->lowest ||
+        (const char *)data + len > visits->highest) {
+        visits->lowest = NULL;  // not in ring memory
+    }
+    memcpy(visits->joined[visits->count], data, len);
+    memcpy(visits->joined[visits->count] + len, wrapped, wrapped_len);
+    if (wrapped_len != 0) {
+        visits->wrapped++;
+    }
+    visits->count++;
+    return visits->count == visits->stop_at;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 256;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_STATS);
+
+    char *msgs[] = {"first", "second", "third"};
+    visits_t visits;
+    rbstats_t stats;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * A batch is visited in place and released at once                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Consume a batch in place\n");
+
+    memset(&visits, 0, sizeof(visits));
+    visits.lowest = rbuf;
+    visits.highest = rbuf + rbuf_size;
+    if (ringbuffer_consume(ringbuffer_context, 10, record_visit, &visits) != 0) {
+        printf("Error: Test 1.1 failed. Consumed from an empty buffer\n");
+        exit(1);
+    }
+    for (int i = 0; i < 3; i++) {
+        assert(ringbuffer_write(ringbuffer_context, msgs[i], strlen(msgs[i]) + 1) == SUCCESS);
+    }
+    if (ringbuffer_consume(ringbuffer_context, 10, record_visit, &visits) != 3 ||
+        visits.count != 3) {
+        printf("Error: Test 1.2 failed. Expected 3 messages, got %d\n", visits.count);
+        exit(1);
+    }
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(visits.joined[i], msgs[i]) != 0) {
+            printf("Error: Test 1.3 failed. Got \"%s\" instead of \"%s\"\n",
+                   visits.joined[i], msgs[i]);
+            exit(1);
+        }
+    }
+    if (visits.lowest == NULL) {
+        printf("Error: Test 1.4 failed. Span outside of ringbuffer memory\n");
+        exit(1);
+    }
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (ringbuffer_context->read != ringbuffer_context->write ||
+        stats.messages_out != 3) {
+        printf("Error: Test 1.5 failed. Messages were not released\n");
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * A message wrapping around the end arrives in two spans                *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Consume a wrapped message\n");
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+    ringbuffer_context->read = ringbuffer_context->end - sizeof(size_t) - 4;
+    ringbuffer_context->write = ringbuffer_context->read;
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+
+    memset(&visits, 0, sizeof(visits));
+    if (ringbuffer_consume(ringbuffer_context, 10, record_visit, &visits) != 1 ||
+        visits.wrapped != 1 || strcmp(visits.joined[0], msg) != 0) {
+        printf("Error: Test 2.1 failed. Expected one message in two spans\n");
+        exit(1);
+    }
+    if (ringbuffer_context->read != ringbuffer_context->write) {
+        printf("Error: Test 2.2 failed. Wrapped message was not released\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * max_messages and the visitor bound a batch                            *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Bound the batch\n");
+
+    for (int i = 0; i < 5; i++) {
+        assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    }
+    memset(&visits, 0, sizeof(visits));
+    if (ringbuffer_consume(ringbuffer_context, 2, record_visit, &visits) != 2) {
+        printf("Error: Test 3.1 failed. max_messages was ignored\n");
+        exit(1);
+    }
+    memset(&visits, 0, sizeof(visits));
+    visits.stop_at = 1;
+    if (ringbuffer_consume(ringbuffer_context, 10, record_visit, &visits) != 1) {
+        printf("Error: Test 3.2 failed. Visitor could not stop the batch\n");
+        exit(1);
+    }
+    memset(&visits, 0, sizeof(visits));
+    if (ringbuffer_consume(ringbuffer_context, 10, record_visit, &visits) != 2) {
+        printf("Error: Test 3.3 failed. Expected the 2 remaining messages\n");
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * Corrupted messages are skipped                                        *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Skip corrupted messages\n");
+
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, msgs[0], strlen(msgs[0]) + 1) == SUCCESS);
+    rbuf[sizeof(size_t) + 2 * sizeof(uint32_t)] ^= 0x1;
+
+    memset(&visits, 0, sizeof(visits));
+    if (ringbuffer_consume(ringbuffer_context, 10, record_visit, &visits) != 1 ||
+        strcmp(visits.joined[0], msgs[0]) != 0) {
+        printf("Error: Test 4.1 failed. Corrupted message was visited\n");
+        exit(1);
+    }
+    if (ringbuffer_context->read != ringbuffer_context->write) {
+        printf("Error: Test 4.2 failed. Corrupted message was not dropped\n");
+        exit(1);
+    }
+    printf("  + Test 4 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(ringbuffer_context);
+    free(rbuf);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf_define.h"
+
+#define NUMBER_OF_PACKETS 100000
+
+typedef struct {
+    size_t id;
+    char payload[24];
+} packet_t;
+
+RINGBUF_DEFINE(packet_ring, packet_t, 16, SPSC)
+RINGBUF_DEFINE(int_ring, int, 8, LOCKED)
+
+void *producer(void *arg) {
+    packet_ring_t *ring = (packet_ring_t *)arg;
+    packet_t packet = {0};
+    for (size_t i = 0; i < NUMBER_OF_PACKETS; i++) {
+        packet.id = i;
+        while (packet_ring_write(ring, &packet) != SUCCESS) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main() {
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Locked ring, single elements and batches across the wrap around       *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Locked ring\n");
+
+    int_ring_t ints;
+    int_ring_init(&ints);
+
+    int value;
+    if (int_ring_read(&ints, &value) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.1 failed. Expected RINGBUFFER_EMPTY\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        assert(int_ring_write(&ints, &i) == SUCCESS);
+    }
+    for (int i = 0; i < 5; i++) {
+        assert(int_ring_read(&ints, &value) == SUCCESS && value == i);
+    }
+
+    /* head is at 5, so a batch of 8 wraps around */
+    int batch[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    if (int_ring_write_n(&ints, batch, 10) != 8 || int_ring_size(&ints) != 8) {
+        printf("Error: Test 1.2 failed. Expected 8 elements to fit\n");
+        exit(1);
+    }
+    if (int_ring_write(&ints, &batch[8]) != RINGBUFFER_FULL) {
+        printf("Error: Test 1.3 failed. Expected RINGBUFFER_FULL\n");
+        exit(1);
+    }
+
+    int out[10];
+    if (int_ring_read_n(&ints, out, 10) != 8) {
+        printf("Error: Test 1.4 failed. Expected 8 elements\n");
+        exit(1);
+    }
+    for (int i = 0; i < 8; i++) {
+        if (out[i] != i) {
+            printf("Error: Test 1.5 failed. Element %d does not match\n", i);
+            exit(1);
+        }
+    }
+    int_ring_destroy(&ints);
+
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Lock-free single producer single consumer ring                        *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Single producer single consumer ring\n");
+
+    packet_ring_t *packets = malloc(sizeof(packet_ring_t));
+    if (packets == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    packet_ring_init(packets);
+
+    pthread_t p_id;
+    pthread_create(&p_id, NULL, producer, packets);
+
+    packet_t received[4];
+    size_t next_id = 0;
+    while (next_id < NUMBER_OF_PACKETS) {
+        size_t n = packet_ring_read_n(packets, received, 4);
+        if (n == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (received[i].id != next_id++) {
+                printf("Error: Test 2.1 failed. Packets out of order\n");
+                exit(1);
+            }
+        }
+    }
+    pthread_join(p_id, NULL);
+    packet_ring_destroy(packets);
+    free(packets);
+
+    printf("  + Test 2 passed\n");
+
+    printf("Test passed!\n");
+    return 0;
+}
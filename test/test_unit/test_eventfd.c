@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+/*
+ * Number of pending notifications on an eventfd (0 if not readable).
+ */
+uint64_t pending(int fd) {
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+
+    size_t rbuf_size = 3 * (msg_len + sizeof(size_t)); // two messages fit
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+
+    char buffer[100];
+    size_t buffer_len = 100;
+
+    int readable = ringbuffer_readable_fd(ringbuffer_context);
+    int writable = ringbuffer_writable_fd(ringbuffer_context);
+    if (readable < 0 || writable < 0) {
+        printf("Error: could not create eventfds\n");
+        exit(1);
+    }
+
+    int epfd = epoll_create1(0);
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = readable};
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, readable, &ev) != 0) {
+        printf("Error: epoll setup failed\n");
+        exit(1);
+    }
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * An empty ringbuffer is not readable                                   *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Empty ringbuffer is not readable\n");
+
+    if (epoll_wait(epfd, &ev, 1, 0) != 0) {
+        printf("Error: Test 1 failed. Empty ringbuffer reported readable\n");
+        exit(1);
+    }
+    printf("Test 1 passed.\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Writes into an empty ringbuffer notify once                           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Notifications are coalesced\n");
+
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+
+    if (epoll_wait(epfd, &ev, 1, 1000) != 1 || ev.data.fd != readable) {
+        printf("Error: Test 2 failed. Ringbuffer not reported readable\n");
+        exit(1);
+    }
+    uint64_t count = pending(readable);
+    if (count != 1) {
+        printf("Error: Test 2 failed. Expected 1 notification, got %lu\n",
+               (unsigned long)count);
+        exit(1);
+    }
+    printf("Test 2 passed.\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * A full ringbuffer fails right away and notifies after a read          *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Writable notification after a failed write\n");
+
+    if (ringbuffer_write(ringbuffer_context, msg, msg_len) != RINGBUFFER_FULL) {
+        printf("Error: Test 3 failed. Non-blocking write did not fail\n");
+        exit(1);
+    }
+    if (pending(writable) != 0) {
+        printf("Error: Test 3 failed. Writable before anything was read\n");
+        exit(1);
+    }
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS);
+    if (pending(writable) != 1) {
+        printf("Error: Test 3 failed. No writable notification\n");
+        exit(1);
+    }
+    buffer_len = 100;
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS);
+    if (pending(writable) != 0) {
+        printf("Error: Test 3 failed. Notified without a failed write\n");
+        exit(1);
+    }
+    printf("Test 3 passed.\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * After draining, the next write notifies again                         *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Drained ringbuffer notifies again\n");
+
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) !=
+        RINGBUFFER_EMPTY) {
+        printf("Error: Test 4 failed. Non-blocking read did not fail\n");
+        exit(1);
+    }
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    if (epoll_wait(epfd, &ev, 1, 1000) != 1 || pending(readable) != 1) {
+        printf("Error: Test 4 failed. No notification after draining\n");
+        exit(1);
+    }
+    printf("Test 4 passed.\n");
+
+    close(epfd);
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("--------------------------------------------------------\n");
+    printf("All tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf.h"
+
+#define LARGE_SIZE (1024 * 1024)
+#define INTERLEAVED_SIZE (64 * 1024)
+
+typedef struct {
+    rbctx_t *ring;
+    uint8_t *message;
+    size_t message_len;
+} writer_t;
+
+void *write_large_message(void *arg) {
+    writer_t *writer = arg;
+    while (ringbuffer_write_large(writer->ring, writer->message,
+                                  writer->message_len) != SUCCESS) {
+    }
+    return NULL;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 256;
+    char* rbuf = malloc(rbuf_size);
+    uint8_t *message = malloc(LARGE_SIZE);
+    uint8_t *buffer = malloc(LARGE_SIZE);
+    if (rbuf == NULL || message == NULL || buffer == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < LARGE_SIZE; i++) {
+        message[i] = (uint8_t)(i * 7 + i / 251);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM);
+
+    size_t buffer_len;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Small messages travel as a single fragment                            *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Single fragment\n");
+
+    char msg[] = "Hello World.";
+    assert(ringbuffer_write_large(ringbuffer_context, msg, sizeof(msg)) == SUCCESS);
+    buffer_len = 4;
+    if (ringbuffer_read_large(ringbuffer_context, buffer, &buffer_len) != OUTPUT_BUFFER_TOO_SMALL ||
+        buffer_len != sizeof(msg)) {
+        printf("Error: Test 1.1 failed. Expected the needed size\n");
+        exit(1);
+    }
+    if (ringbuffer_read_large(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != sizeof(msg) || strcmp((char *)buffer, msg) != 0) {
+        printf("Error: Test 1.2 failed. Message was not kept after OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+    if (ringbuffer_read_large(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.3 failed. Expected RINGBUFFER_EMPTY\n");
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * A message much larger than the ringbuffer                             *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: 1 MB through a %zu byte ringbuffer\n", rbuf_size);
+
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+    if (ringbuffer_write(ringbuffer_context, message, LARGE_SIZE) != RINGBUFFER_FULL) {
+        printf("Error: Test 2.1 failed. Plain write did not fail\n");
+        exit(1);
+    }
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM);
+
+    writer_t writer = {ringbuffer_context, message, LARGE_SIZE};
+    pthread_t thread;
+    pthread_create(&thread, NULL, write_large_message, &writer);
+    buffer_len = LARGE_SIZE;
+    while (ringbuffer_read_large(ringbuffer_context, buffer, &buffer_len) == RINGBUFFER_EMPTY) {
+    }
+    pthread_join(thread, NULL);
+    if (buffer_len != LARGE_SIZE || memcmp(buffer, message, LARGE_SIZE) != 0) {
+        printf("Error: Test 2.2 failed. Reassembled message differs\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Fragments of concurrent writers do not interleave                     *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Concurrent large writers\n");
+
+    uint8_t *messages[2] = {message, message + INTERLEAVED_SIZE};
+    memset(messages[0], 'a', INTERLEAVED_SIZE);
+    memset(messages[1], 'b', INTERLEAVED_SIZE);
+    pthread_t threads[2];
+    writer_t writers[2];
+    for (int w = 0; w < 2; w++) {
+        writers[w] = (writer_t){ringbuffer_context, messages[w], INTERLEAVED_SIZE};
+        pthread_create(&threads[w], NULL, write_large_message, &writers[w]);
+    }
+    for (int m = 0; m < 2; m++) {
+        buffer_len = LARGE_SIZE;
+        while (ringbuffer_read_large(ringbuffer_context, buffer, &buffer_len) == RINGBUFFER_EMPTY) {
+        }
+        if (buffer_len != INTERLEAVED_SIZE ||
+            (memcmp(buffer, messages[0], INTERLEAVED_SIZE) != 0 &&
+             memcmp(buffer, messages[1], INTERLEAVED_SIZE) != 0)) {
+            printf("Error: Test 3.1 failed. Fragments interleaved\n");
+            exit(1);
+        }
+    }
+    for (int w = 0; w < 2; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * Messages of ringbuffer_write are not taken for fragments              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Plain messages\n");
+
+    char plain[][16] = {"Hi", "Hello World."};
+    size_t plain_len[] = {3, sizeof("Hello World.")};
+    for (int m = 0; m < 2; m++) {
+        assert(ringbuffer_write(ringbuffer_context, plain[m], plain_len[m]) == SUCCESS);
+        buffer_len = LARGE_SIZE;
+        if (ringbuffer_read_large(ringbuffer_context, buffer, &buffer_len) !=
+                INVALID_MESSAGE_LENGTH ||
+            buffer_len != LARGE_SIZE) {
+            printf("Error: Test 4.1 failed. Message %d was read as a fragment\n", m);
+            exit(1);
+        }
+        buffer_len = LARGE_SIZE;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer_len != plain_len[m] || strcmp((char *)buffer, plain[m]) != 0) {
+            printf("Error: Test 4.2 failed. Message %d was not kept\n", m);
+            exit(1);
+        }
+    }
+    printf("  + Test 4 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(buffer);
+    free(message);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
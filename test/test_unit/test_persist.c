@@ -0,0 +1,146 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+#define RBUF_SIZE 100
+
+int main() {
+    char path[] = "/tmp/test_persist_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Error: mkstemp failed\n");
+        exit(1);
+    }
+    close(fd);
+
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+    char buffer[100];
+    size_t buffer_len = 100;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Messages survive a crash of the writing process                       *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Messages survive a crash\n");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (ringbuffer_open(ringbuffer_context, path, RBUF_SIZE) != SUCCESS) {
+            _exit(1);
+        }
+        ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_CHECKSUM);
+        for (int i = 0; i < 3; i++) {
+            msg[0] = 'A' + i;
+            if (ringbuffer_write(ringbuffer_context, msg, msg_len) != SUCCESS) {
+                _exit(1);
+            }
+        }
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS) {
+            _exit(1);
+        }
+        // Die without ringbuffer_destroy
+        kill(getpid(), SIGKILL);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFSIGNALED(status)) {
+        printf("Error: Test 1.1 failed. Child could not use the ringbuffer\n");
+        exit(1);
+    }
+
+    if (ringbuffer_open(ringbuffer_context, path, RBUF_SIZE) != SUCCESS) {
+        printf("Error: Test 1.2 failed. Could not reopen the ringbuffer\n");
+        exit(1);
+    }
+    if (!(ringbuffer_context->flags & RBUF_FLAG_CHECKSUM)) {
+        printf("Error: Test 1.3 failed. Checksum flag was not restored\n");
+        exit(1);
+    }
+    for (int i = 1; i < 3; i++) {
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer[0] != 'A' + i || strcmp(buffer + 1, msg + 1) != 0) {
+            printf("Error: Test 1.4 failed. Message %d was not recovered\n", i);
+            exit(1);
+        }
+    }
+    buffer_len = 100;
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.5 failed. Expected an empty ringbuffer\n");
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Positions are kept across a clean restart and wrap around             *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Restart with wrapped messages\n");
+
+    for (int round = 0; round < 20; round++) {
+        msg[0] = 'a' + round;
+        if (ringbuffer_write(ringbuffer_context, msg, msg_len) != SUCCESS) {
+            printf("Error: Test 2.1 failed. Write %d failed\n", round);
+            exit(1);
+        }
+        ringbuffer_destroy(ringbuffer_context);
+        if (ringbuffer_open(ringbuffer_context, path, RBUF_SIZE) != SUCCESS) {
+            printf("Error: Test 2.2 failed. Reopen %d failed\n", round);
+            exit(1);
+        }
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer[0] != 'a' + round) {
+            printf("Error: Test 2.3 failed. Message %d was not recovered\n", round);
+            exit(1);
+        }
+    }
+    ringbuffer_destroy(ringbuffer_context);
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Files of another size or content are rejected                         *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Invalid files are rejected\n");
+
+    if (ringbuffer_open(ringbuffer_context, path, 2 * RBUF_SIZE) != RINGBUFFER_IO_ERROR ||
+        errno != EINVAL) {
+        printf("Error: Test 3.1 failed. Opened with the wrong size\n");
+        exit(1);
+    }
+    FILE *file = fopen(path, "r+");
+    fputs("garbage", file);
+    fclose(file);
+    if (ringbuffer_open(ringbuffer_context, path, RBUF_SIZE) != RINGBUFFER_IO_ERROR) {
+        printf("Error: Test 3.2 failed. Opened a corrupt file\n");
+        exit(1);
+    }
+    if (ringbuffer_open(ringbuffer_context, "/nonexistent/ringbuffer", RBUF_SIZE) !=
+        RINGBUFFER_IO_ERROR) {
+        printf("Error: Test 3.3 failed. Opened an impossible path\n");
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    unlink(path);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -107,6 +107,15 @@ int main() {
         exit(1);
     }
 
+    char buffer_large_enough[msg_len];
+    buffer_len = msg_len;
+
+    if (ringbuffer_read(ringbuffer_context, buffer_large_enough, &buffer_len) != SUCCESS ||
+        buffer_len != msg_len || strcmp(buffer_large_enough, msg) != 0) {
+        printf("Error: Test 2.1.2 failed. Message was not kept after OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+
     free(rbuf);
 
     printf("  + Test 2.1 passed\n");
@@ -162,6 +171,14 @@ int main() {
         exit(1);
     }
 
+    buffer_len = msg_len;
+
+    if (ringbuffer_read(ringbuffer_context, buffer_large_enough, &buffer_len) != SUCCESS ||
+        buffer_len != msg_len || strcmp(buffer_large_enough, msg) != 0) {
+        printf("Error: Test 2.2 failed. Message was not kept after OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+
     free(rbuf);
 
     printf("  + Test 2.2 passed\n");
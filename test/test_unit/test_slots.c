@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf.h"
+
+#define SLOT_SIZE 16
+#define NUMBER_OF_SLOTS 4
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    /* trailing bytes that don't form a whole slot are unused */
+    size_t rbuf_size = NUMBER_OF_SLOTS * SLOT_SIZE + 5;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init_slots(ringbuffer_context, rbuf, rbuf_size, SLOT_SIZE);
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Setup and invalid arguments                                           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Setup and invalid arguments\n");
+
+    if (ringbuffer_context->end != (uint8_t*) rbuf + NUMBER_OF_SLOTS * SLOT_SIZE) {
+        printf("Error: Test 1.1 failed. End pointer is not slot aligned\n");
+        exit(1);
+    }
+
+    char record[SLOT_SIZE];
+    char buffer[SLOT_SIZE];
+    size_t buffer_len = SLOT_SIZE;
+    memset(record, 'a', SLOT_SIZE);
+
+    if (ringbuffer_write(ringbuffer_context, record, SLOT_SIZE - 1) != INVALID_MESSAGE_LENGTH) {
+        printf("Error: Test 1.2 failed. Expected INVALID_MESSAGE_LENGTH\n");
+        exit(1);
+    }
+
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.3 failed. Expected RINGBUFFER_EMPTY\n");
+        exit(1);
+    }
+
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Fill all usable slots, one slot always stays free                     *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Fill all usable slots\n");
+
+    for (int i = 0; i < NUMBER_OF_SLOTS - 1; i++) {
+        memset(record, 'a' + i, SLOT_SIZE);
+        if (ringbuffer_write(ringbuffer_context, record, SLOT_SIZE) != SUCCESS) {
+            printf("Error: Test 2.1 failed. Write %d failed\n", i);
+            exit(1);
+        }
+    }
+
+    /* no length prefix, records are packed back to back */
+    if (ringbuffer_context->write != (uint8_t*) rbuf + (NUMBER_OF_SLOTS - 1) * SLOT_SIZE) {
+        printf("Error: Test 2.2 failed. Records are not packed\n");
+        exit(1);
+    }
+
+    if (ringbuffer_write(ringbuffer_context, record, SLOT_SIZE) != RINGBUFFER_FULL) {
+        printf("Error: Test 2.3 failed. Expected RINGBUFFER_FULL\n");
+        exit(1);
+    }
+
+    buffer_len = SLOT_SIZE - 1;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != OUTPUT_BUFFER_TOO_SMALL) {
+        printf("Error: Test 2.4 failed. Expected OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Records keep their order across many wrap arounds                     *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Read and write across wrap arounds\n");
+
+    for (int i = 0; i < 10 * NUMBER_OF_SLOTS; i++) {
+        buffer_len = SLOT_SIZE;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS) {
+            printf("Error: Test 3.1 failed. Read %d failed\n", i);
+            exit(1);
+        }
+        memset(record, 'a' + (i % 26), SLOT_SIZE);
+        if (buffer_len != SLOT_SIZE || memcmp(buffer, record, SLOT_SIZE) != 0) {
+            printf("Error: Test 3.2 failed. Record %d does not match\n", i);
+            exit(1);
+        }
+
+        memset(record, 'a' + ((i + NUMBER_OF_SLOTS - 1) % 26), SLOT_SIZE);
+        if (ringbuffer_write(ringbuffer_context, record, SLOT_SIZE) != SUCCESS) {
+            printf("Error: Test 3.3 failed. Write %d failed\n", i);
+            exit(1);
+        }
+    }
+
+    printf("  + Test 3 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+#define NUMBER_OF_MESSAGES 10
+
+int main() {
+    char path[] = "/tmp/test_spill_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Error: mkstemp failed\n");
+        exit(1);
+    }
+    close(fd);
+
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+
+    size_t rbuf_size = 3 * (msg_len + sizeof(size_t)); // two messages fit
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_STATS | RBUF_FLAG_NONBLOCK);
+    if (ringbuffer_enable_spill(ringbuffer_context, path) != SUCCESS) {
+        printf("Error: could not enable spilling\n");
+        exit(1);
+    }
+
+    char buffer[100];
+    size_t buffer_len = 100;
+    rbstats_t stats;
+    struct stat st;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Writes to a full ringbuffer go to the spill file                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Overflow into the spill file\n");
+
+    for (int i = 0; i < NUMBER_OF_MESSAGES; i++) {
+        msg[0] = 'A' + i;
+        if (ringbuffer_write(ringbuffer_context, msg, msg_len) != SUCCESS) {
+            printf("Error: Test 1.1 failed. Write %d failed\n", i);
+            exit(1);
+        }
+    }
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.spilled != NUMBER_OF_MESSAGES - 2 || stats.full != 0) {
+        printf("Error: Test 1.2 failed. Expected %d spilled messages, got %lu\n",
+               NUMBER_OF_MESSAGES - 2, (unsigned long)stats.spilled);
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Messages come back in order, also when writing while draining         *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: FIFO order across ring and spill file\n");
+
+    for (int i = 0; i < 2 * NUMBER_OF_MESSAGES; i++) {
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer_len != msg_len || buffer[0] != 'A' + i) {
+            printf("Error: Test 2.1 failed. Message %d out of order\n", i);
+            exit(1);
+        }
+        // The ring has room again, but the spill file is not drained yet
+        msg[0] = 'A' + NUMBER_OF_MESSAGES + i;
+        if (i < NUMBER_OF_MESSAGES &&
+            ringbuffer_write(ringbuffer_context, msg, msg_len) != SUCCESS) {
+            printf("Error: Test 2.2 failed. Write %d failed\n", i);
+            exit(1);
+        }
+    }
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 2.3 failed. Expected an empty ringbuffer\n");
+        exit(1);
+    }
+    if (stat(path, &st) != 0 || st.st_size != 0) {
+        printf("Error: Test 2.4 failed. Spill file was not truncated\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * Large messages and small buffers                                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Large spilled messages\n");
+
+    char large[200];
+    memset(large, 'x', sizeof(large));
+    if (ringbuffer_write(ringbuffer_context, large, sizeof(large)) != SUCCESS) {
+        printf("Error: Test 3.1 failed. Message larger than the ring not spilled\n");
+        exit(1);
+    }
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) !=
+        OUTPUT_BUFFER_TOO_SMALL) {
+        printf("Error: Test 3.2 failed. Expected OUTPUT_BUFFER_TOO_SMALL\n");
+        exit(1);
+    }
+    char large_buffer[200];
+    buffer_len = sizeof(large_buffer);
+    if (ringbuffer_read(ringbuffer_context, large_buffer, &buffer_len) != SUCCESS ||
+        buffer_len != sizeof(large) || memcmp(large, large_buffer, sizeof(large)) != 0) {
+        printf("Error: Test 3.3 failed. Large message was lost\n");
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * Spilled messages move back, writes return to the ring                 *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Move spilled messages back\n");
+
+    for (int i = 0; i < 4; i++) {
+        msg[0] = 'a' + i;
+        assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    }
+    ringbuffer_stats(ringbuffer_context, &stats);
+    uint64_t spilled = stats.spilled;
+    for (int i = 0; i < 3; i++) {
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer[0] != 'a' + i) {
+            printf("Error: Test 4.1 failed. Message %d out of order\n", i);
+            exit(1);
+        }
+    }
+    /* the last spilled message is back in the ring, next to free space */
+    if (stat(path, &st) != 0 || st.st_size != 0) {
+        printf("Error: Test 4.2 failed. Spill file was not drained into the ring\n");
+        exit(1);
+    }
+    msg[0] = 'e';
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.spilled != spilled) {
+        printf("Error: Test 4.3 failed. Write did not return to the ring\n");
+        exit(1);
+    }
+    for (int i = 0; i < 2; i++) {
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            buffer[0] != 'd' + i) {
+            printf("Error: Test 4.4 failed. Message %d out of order\n", i);
+            exit(1);
+        }
+    }
+    // Fragments would go to the ring ahead of spilled messages
+    if (ringbuffer_write_large(ringbuffer_context, msg, msg_len) !=
+        INVALID_MESSAGE_LENGTH) {
+        printf("Error: Test 4.5 failed. Fragmented write with a spill file\n");
+        exit(1);
+    }
+    printf("  + Test 4 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    unlink(path);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
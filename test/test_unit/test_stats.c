@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf.h"
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+
+    size_t rbuf_size = 3 * (msg_len + sizeof(size_t)); // two messages fit
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+
+    char buffer[100];
+    size_t buffer_len = 100;
+    rbstats_t stats;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Nothing is counted unless statistics are enabled                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Statistics are opt-in\n");
+
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS);
+
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.messages_in != 0 || stats.messages_out != 0) {
+        printf("Error: Test 1 failed. Counted without RBUF_FLAG_STATS\n");
+        exit(1);
+    }
+
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Traffic, full and empty returns                                       *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Count traffic\n");
+
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_STATS);
+
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == RINGBUFFER_FULL);
+    buffer_len = 100;
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS);
+    buffer_len = 100;
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS);
+    buffer_len = 100;
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == RINGBUFFER_EMPTY);
+
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.messages_in != 2 || stats.bytes_in != 2 * msg_len) {
+        printf("Error: Test 2.1 failed. Wrong write counters\n");
+        exit(1);
+    }
+    if (stats.messages_out != 2 || stats.bytes_out != 2 * msg_len) {
+        printf("Error: Test 2.2 failed. Wrong read counters\n");
+        exit(1);
+    }
+    if (stats.full != 1 || stats.empty != 1) {
+        printf("Error: Test 2.3 failed. Expected one full and one empty return\n");
+        exit(1);
+    }
+    if (stats.high_water != 2 * (msg_len + sizeof(size_t))) {
+        printf("Error: Test 2.4 failed. Wrong high water mark %lu\n", stats.high_water);
+        exit(1);
+    }
+
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * The full write waited RBUF_TIMEOUT                                    *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Blocked time\n");
+
+    if (stats.timeouts != 1) {
+        printf("Error: Test 3.1 failed. Expected one timeout\n");
+        exit(1);
+    }
+
+    /* one second lands in the [2^19, 2^20) us bucket */
+    if (stats.write_blocked_us[20] != 1) {
+        printf("Error: Test 3.2 failed. Wait not found in histogram\n");
+        exit(1);
+    }
+
+    printf("  + Test 3 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf.h"
+
+#define STREAM_SIZE 10000
+#define WRITE_CHUNK 7
+#define READ_CHUNK 13
+
+int collect_bytes(void *user, const void *data, size_t len, const void *wrapped,
+                  size_t wrapped_len) {
+    char *collected = user;
+    memcpy(collected, data, len);
+    memcpy(collected + len, wrapped, wrapped_len);
+    collected[len + wrapped_len] = '\0';
+    return 0;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 64;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init_stream(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+
+    char buffer[100];
+    size_t buffer_len;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Writes are joined without headers, reads take what is there           *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Bytes without boundaries\n");
+
+    assert(ringbuffer_write(ringbuffer_context, "Hello ", 6) == SUCCESS);
+    assert(ringbuffer_write(ringbuffer_context, "World", 5) == SUCCESS);
+    if (ringbuffer_context->write - ringbuffer_context->read != 11) {
+        printf("Error: Test 1.1 failed. Writes were framed\n");
+        exit(1);
+    }
+    buffer_len = 4;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != 4 || memcmp(buffer, "Hell", 4) != 0) {
+        printf("Error: Test 1.2 failed. Expected the first 4 bytes\n");
+        exit(1);
+    }
+    buffer_len = sizeof(buffer);
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != 7 || memcmp(buffer, "o World", 7) != 0) {
+        printf("Error: Test 1.3 failed. Expected the remaining 7 bytes\n");
+        exit(1);
+    }
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.4 failed. Expected RINGBUFFER_EMPTY\n");
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Writes are all or nothing, also around the end                        *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Full and wrapped\n");
+
+    ringbuffer_context->read = ringbuffer_context->end - 5;
+    ringbuffer_context->write = ringbuffer_context->read;
+    char full[64];
+    memset(full, 'x', sizeof(full));
+    if (ringbuffer_write(ringbuffer_context, full, rbuf_size) != RINGBUFFER_FULL ||
+        ringbuffer_context->write != ringbuffer_context->read) {
+        printf("Error: Test 2.1 failed. Expected RINGBUFFER_FULL without writing\n");
+        exit(1);
+    }
+    assert(ringbuffer_write(ringbuffer_context, "0123456789", 10) == SUCCESS);
+    char collected[100];
+    if (ringbuffer_consume(ringbuffer_context, 10, collect_bytes, collected) != 1 ||
+        strcmp(collected, "0123456789") != 0) {
+        printf("Error: Test 2.2 failed. Wrapped bytes were not visited\n");
+        exit(1);
+    }
+    assert(ringbuffer_write(ringbuffer_context, full, rbuf_size - 1) == SUCCESS);
+    buffer_len = sizeof(buffer);
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != rbuf_size - 1 || memcmp(buffer, full, buffer_len) != 0) {
+        printf("Error: Test 2.3 failed. Full ringbuffer was not read back\n");
+        exit(1);
+    }
+    if (ringbuffer_enable_spill(ringbuffer_context, "/tmp/test_stream_spill") !=
+        RINGBUFFER_IO_ERROR) {
+        printf("Error: Test 2.4 failed. Stream ringbuffer accepted a spill file\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * A stream much larger than the ringbuffer, in mismatched chunks        *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Stream %d bytes\n", STREAM_SIZE);
+
+    char *source = malloc(STREAM_SIZE);
+    char *destination = malloc(STREAM_SIZE);
+    for (int i = 0; i < STREAM_SIZE; i++) {
+        source[i] = 'a' + i % 26;
+    }
+    size_t written = 0, read = 0;
+    for (int round = 0; read < STREAM_SIZE; round++) {
+        size_t chunk = STREAM_SIZE - written < WRITE_CHUNK ? STREAM_SIZE - written : WRITE_CHUNK;
+        if (chunk > 0 &&
+            ringbuffer_write(ringbuffer_context, source + written, chunk) == SUCCESS) {
+            written += chunk;
+        }
+        // Read less often than written, so the ringbuffer runs full
+        buffer_len = READ_CHUNK;
+        if (round % 2 == 1 &&
+            ringbuffer_read(ringbuffer_context, destination + read, &buffer_len) == SUCCESS) {
+            read += buffer_len;
+        }
+    }
+    if (memcmp(source, destination, STREAM_SIZE) != 0) {
+        printf("Error: Test 3.1 failed. Stream was corrupted\n");
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(destination);
+    free(source);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
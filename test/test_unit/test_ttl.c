@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../include/ringbuf.h"
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 1024;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context,
+                         RBUF_FLAG_EXPIRY | RBUF_FLAG_STATS | RBUF_FLAG_NONBLOCK);
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+    char buffer[100];
+    size_t buffer_len = 100;
+    rbstats_t stats;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Expired messages are skipped in one read                              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Skip expired messages\n");
+
+    for (int i = 0; i < 5; i++) {
+        assert(ringbuffer_write_ttl(ringbuffer_context, msg, msg_len, 1000) == SUCCESS);
+    }
+    char live[] = "still here";
+    assert(ringbuffer_write(ringbuffer_context, live, sizeof(live)) == SUCCESS);
+    usleep(3000);
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        strcmp(buffer, live) != 0) {
+        printf("Error: Test 1.1 failed. Did not skip to the live message\n");
+        exit(1);
+    }
+    ringbuffer_stats(ringbuffer_context, &stats);
+    if (stats.expired != 5 || stats.messages_out != 1) {
+        printf("Error: Test 1.2 failed. Expected 5 expired messages, got %lu\n",
+               (unsigned long)stats.expired);
+        exit(1);
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Live messages are delivered, expired space is reclaimed               *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Deliver before the deadline\n");
+
+    assert(ringbuffer_write_ttl(ringbuffer_context, msg, msg_len, 1000000) == SUCCESS);
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        strcmp(buffer, msg) != 0) {
+        printf("Error: Test 2.1 failed. Live message was not delivered\n");
+        exit(1);
+    }
+
+    while (ringbuffer_write_ttl(ringbuffer_context, msg, msg_len, 1000) == SUCCESS) {
+    }
+    usleep(3000);
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY ||
+        ringbuffer_context->read != ringbuffer_context->write) {
+        printf("Error: Test 2.2 failed. Expired messages were not reclaimed\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * TTLs are ignored without RBUF_FLAG_EXPIRY                             *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: No expiry without the flag\n");
+
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+    assert(ringbuffer_write_ttl(ringbuffer_context, msg, msg_len, 1) == SUCCESS);
+    usleep(1000);
+    buffer_len = 100;
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+        buffer_len != msg_len) {
+        printf("Error: Test 3.1 failed. Message expired without RBUF_FLAG_EXPIRY\n");
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../include/ringbuf.h"
+
+#define GROUPS_PER_PRODUCER 200
+#define GROUP_SIZE 4
+
+typedef struct {
+    rbctx_t *ring;
+    int id;
+} producer_t;
+
+void *produce_groups(void *arg) {
+    producer_t *producer = arg;
+    uint8_t stage[GROUP_SIZE * (sizeof(size_t) + 2 * sizeof(int))];
+    rbtxn_t txn;
+    ringbuffer_txn_begin(&txn, producer->ring, stage, sizeof(stage));
+    for (int group = 0; group < GROUPS_PER_PRODUCER; group++) {
+        for (int i = 0; i < GROUP_SIZE; i++) {
+            int message[2] = {producer->id, i};
+            assert(ringbuffer_txn_append(&txn, message, sizeof(message)) == SUCCESS);
+        }
+        while (ringbuffer_txn_commit(&txn) != SUCCESS) {
+        }
+    }
+    return NULL;
+}
+
+int main() {
+    rbctx_t *ringbuffer_context = malloc(sizeof(rbctx_t));
+    if (ringbuffer_context == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+
+    size_t rbuf_size = 100;
+    char* rbuf = malloc(rbuf_size);
+    if (rbuf == NULL) {
+        printf("Error: malloc failed\n");
+        exit(1);
+    }
+    ringbuffer_init(ringbuffer_context, rbuf, rbuf_size);
+    ringbuffer_set_flags(ringbuffer_context, RBUF_FLAG_NONBLOCK);
+
+    char msg[] = "Hello World.";
+    size_t msg_len = strlen(msg) + 1;
+    char buffer[100];
+    size_t buffer_len = 100;
+    uint8_t stage[256];
+    rbtxn_t txn;
+
+    /*************************************************************************
+     * TEST 1:                                                               *
+     * Messages become visible on commit only                                *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 1: Publish on commit\n");
+
+    ringbuffer_txn_begin(&txn, ringbuffer_context, stage, sizeof(stage));
+    for (int i = 0; i < 3; i++) {
+        assert(ringbuffer_txn_append(&txn, msg, msg_len) == SUCCESS);
+    }
+    if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != RINGBUFFER_EMPTY) {
+        printf("Error: Test 1.1 failed. Staged message was visible\n");
+        exit(1);
+    }
+    if (ringbuffer_txn_commit(&txn) != SUCCESS || txn.staged_messages != 0) {
+        printf("Error: Test 1.2 failed. Commit failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < 3; i++) {
+        buffer_len = 100;
+        if (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) != SUCCESS ||
+            strcmp(buffer, msg) != 0) {
+            printf("Error: Test 1.3 failed. Message %d missing\n", i);
+            exit(1);
+        }
+    }
+    printf("  + Test 1 passed\n");
+
+    /*************************************************************************
+     * TEST 2:                                                               *
+     * Abort discards the group                                              *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 2: Abort a transaction\n");
+
+    assert(ringbuffer_txn_append(&txn, msg, msg_len) == SUCCESS);
+    ringbuffer_txn_abort(&txn);
+    if (ringbuffer_txn_commit(&txn) != SUCCESS ||
+        ringbuffer_context->read != ringbuffer_context->write) {
+        printf("Error: Test 2.1 failed. Aborted message was published\n");
+        exit(1);
+    }
+    printf("  + Test 2 passed\n");
+
+    /*************************************************************************
+     * TEST 3:                                                               *
+     * All or nothing                                                        *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 3: Commit all or nothing\n");
+
+    // 4 records of 21 bytes fit the ringbuffer, but not next to one more
+    assert(ringbuffer_write(ringbuffer_context, msg, msg_len) == SUCCESS);
+    for (int i = 0; i < 4; i++) {
+        assert(ringbuffer_txn_append(&txn, msg, msg_len) == SUCCESS);
+    }
+    if (ringbuffer_txn_append(&txn, msg, msg_len) != RINGBUFFER_FULL) {
+        printf("Error: Test 3.1 failed. Group larger than the ringbuffer was accepted\n");
+        exit(1);
+    }
+    uint8_t *write_before = ringbuffer_context->write;
+    if (ringbuffer_txn_commit(&txn) != RINGBUFFER_FULL ||
+        ringbuffer_context->write != write_before) {
+        printf("Error: Test 3.2 failed. Expected RINGBUFFER_FULL without writes\n");
+        exit(1);
+    }
+    buffer_len = 100;
+    assert(ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS);
+    if (ringbuffer_txn_commit(&txn) != SUCCESS) {
+        printf("Error: Test 3.3 failed. Retried commit failed\n");
+        exit(1);
+    }
+    int count = 0;
+    buffer_len = 100;
+    while (ringbuffer_read(ringbuffer_context, buffer, &buffer_len) == SUCCESS) {
+        count++;
+        buffer_len = 100;
+    }
+    if (count != 4) {
+        printf("Error: Test 3.4 failed. Expected 4 messages, got %d\n", count);
+        exit(1);
+    }
+    printf("  + Test 3 passed\n");
+
+    /*************************************************************************
+     * TEST 4:                                                               *
+     * Groups of concurrent producers do not interleave                      *
+     *************************************************************************/
+    printf("--------------------------------------------------------\n");
+    printf("Test 4: Concurrent producers\n");
+
+    ringbuffer_set_flags(ringbuffer_context, 0);
+    pthread_t threads[2];
+    producer_t producers[2];
+    for (int p = 0; p < 2; p++) {
+        producers[p].ring = ringbuffer_context;
+        producers[p].id = p;
+        pthread_create(&threads[p], NULL, produce_groups, &producers[p]);
+    }
+    int received = 0;
+    int group_owner = -1;
+    while (received < 2 * GROUPS_PER_PRODUCER * GROUP_SIZE) {
+        int message[2];
+        buffer_len = sizeof(message);
+        if (ringbuffer_read(ringbuffer_context, message, &buffer_len) != SUCCESS) {
+            continue;
+        }
+        if (message[1] == 0) {
+            group_owner = message[0];
+        }
+        if (message[0] != group_owner || message[1] != received % GROUP_SIZE) {
+            printf("Error: Test 4.1 failed. Groups interleaved at message %d\n", received);
+            exit(1);
+        }
+        received++;
+    }
+    for (int p = 0; p < 2; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    printf("  + Test 4 passed\n");
+
+    ringbuffer_destroy(ringbuffer_context);
+    free(rbuf);
+    free(ringbuffer_context);
+
+    printf("Test passed!\n");
+    return 0;
+}
@@ -16,6 +16,21 @@ test_executables=(
   "./build/test_unthreaded_wrap/test_long"
   "./build/test_unit/test_read"
   "./build/test_unit/test_write"
+  "./build/test_unit/test_slots"
+  "./build/test_unit/test_define"
+  "./build/test_unit/test_stats"
+  "./build/test_unit/test_checksum"
+  "./build/test_unit/test_eventfd"
+  "./build/test_unit/test_persist"
+  "./build/test_unit/test_coalesce"
+  "./build/test_unit/test_spill"
+  "./build/test_unit/test_codel"
+  "./build/test_unit/test_ttl"
+  "./build/test_unit/test_consume"
+  "./build/test_unit/test_txn"
+  "./build/test_unit/test_large"
+  "./build/test_unit/test_close"
+  "./build/test_unit/test_stream"
 )
 
 for test_executable in "${test_executables[@]}"; do
@@ -60,6 +75,12 @@ done
 
 test_executables_threaded=(
   "./build/test_threaded/test"
+  "./build/test_threaded/test_pipeline"
+  "./build/test_threaded/test_pool"
+  "./build/test_threaded/test_poll"
+  "./build/test_threaded/test_mpsc"
+  "./build/test_cpp/test_ring"
+  "./build/test_cpp/test_coro"
   "./build/test_daemon/test"
 )
 